@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Mesh.h"
+
+// Bounded multi-producer/multi-consumer ring (Vyukov). Each slot carries a sequence
+// number so producers and consumers only contend on the head/tail counters.
+template<typename T>
+class LockFreeQueue {
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Slot[]> slots_;
+	size_t mask_;
+	alignas(64) std::atomic<size_t> head_{ 0 };
+	alignas(64) std::atomic<size_t> tail_{ 0 };
+
+public:
+	explicit LockFreeQueue(size_t capacity) {
+		size_t size = 2;
+		while (size < capacity) size <<= 1;
+		slots_ = std::make_unique<Slot[]>(size);
+		mask_ = size - 1;
+		for (size_t i = 0; i < size; ++i)
+			slots_[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	bool try_push(T& value) {
+		size_t pos = tail_.load(std::memory_order_relaxed);
+		while (true) {
+			Slot& slot = slots_[pos & mask_];
+			size_t seq = slot.sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+			if (diff == 0) {
+				if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					slot.value = std::move(value);
+					slot.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = tail_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool try_pop(T& out) {
+		size_t pos = head_.load(std::memory_order_relaxed);
+		while (true) {
+			Slot& slot = slots_[pos & mask_];
+			size_t seq = slot.sequence.load(std::memory_order_acquire);
+			auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+			if (diff == 0) {
+				if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					out = std::move(slot.value);
+					slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) {
+				return false;
+			}
+			else {
+				pos = head_.load(std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+// Parses OBJ files on worker threads and hands finished meshes to the render loop.
+// Requests are queued under a mutex (workers sleep on it); completed meshes travel
+// back through a lock-free queue so the render thread never blocks on a worker. When
+// that queue is full, workers park on a condition variable; the render thread only
+// signals it when a worker is parked, and without taking the lock, so a parked worker
+// also rechecks the queue every few milliseconds in case a signal slipped past it.
+class AssetLoader {
+public:
+	using MeshPass = std::function<void(Mesh&)>;
+
+private:
+	struct Job {
+		std::string filename;
+		MeshPass pass;
+	};
+
+	std::vector<std::thread> workers_;
+	std::deque<Job> jobs_;
+	std::mutex jobs_mutex_;
+	std::condition_variable jobs_cv_;
+	std::mutex space_mutex_;
+	std::condition_variable space_cv_;
+	std::atomic<int> parked_{ 0 };
+	std::atomic<bool> stopping_{ false };
+
+	LockFreeQueue<std::unique_ptr<Mesh>> finished_;
+	std::atomic<int> pending_{ 0 };
+	std::atomic<int> failed_{ 0 };
+
+	void worker_loop() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock lock(jobs_mutex_);
+				jobs_cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+				if (stopping_) return;
+				job = std::move(jobs_.front());
+				jobs_.pop_front();
+			}
+
+			// A malformed file may throw from the parser; it must not take the process down.
+			auto mesh = std::make_unique<Mesh>();
+			bool loaded = false;
+			try {
+				loaded = mesh->load_from_obj(job.filename);
+				if (loaded && job.pass) job.pass(*mesh);
+			}
+			catch (const std::exception& error) {
+				std::cerr << "Error: Failed to load " << job.filename << ": " << error.what() << "\n";
+				loaded = false;
+			}
+			if (!loaded) {
+				failed_.fetch_add(1, std::memory_order_relaxed);
+				pending_.fetch_sub(1, std::memory_order_release);
+				continue;
+			}
+
+			if (finished_.try_push(mesh)) continue;
+			bool pushed = false;
+			std::unique_lock lock(space_mutex_);
+			parked_.fetch_add(1);
+			while (!space_cv_.wait_for(lock, std::chrono::milliseconds(5), [&] { return (pushed = finished_.try_push(mesh)) || stopping_; })) {}
+			parked_.fetch_sub(1);
+			if (!pushed) return;
+		}
+	}
+
+public:
+	explicit AssetLoader(unsigned int worker_count = 0, size_t queue_capacity = 64)
+		: finished_(queue_capacity) {
+		if (worker_count == 0)
+			worker_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+		for (unsigned int i = 0; i < worker_count; ++i)
+			workers_.emplace_back(&AssetLoader::worker_loop, this);
+	}
+
+	~AssetLoader() {
+		{
+			std::lock_guard lock(jobs_mutex_);
+			stopping_ = true;
+		}
+		jobs_cv_.notify_all();
+		{
+			std::lock_guard lock(space_mutex_);
+		}
+		space_cv_.notify_all();
+		for (auto& worker : workers_)
+			worker.join();
+	}
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// pass runs on the worker after the mesh is parsed and its normals generated.
+	void load(const std::string& filename, MeshPass pass = {}) {
+		pending_.fetch_add(1, std::memory_order_relaxed);
+		{
+			std::lock_guard lock(jobs_mutex_);
+			jobs_.push_back({ filename, std::move(pass) });
+		}
+		jobs_cv_.notify_one();
+	}
+
+	// Called from the render loop; never blocks or takes a lock.
+	std::unique_ptr<Mesh> try_take() {
+		std::unique_ptr<Mesh> mesh;
+		if (finished_.try_pop(mesh)) {
+			pending_.fetch_sub(1, std::memory_order_release);
+			if (parked_.load() > 0) space_cv_.notify_one();
+		}
+		return mesh;
+	}
+
+	int pending() const { return pending_.load(std::memory_order_acquire); }
+	// Workers holding a finished mesh while the queue to the render thread is full.
+	int parked() const { return parked_.load(); }
+	// Loads that could not be opened or parsed; each is also reported on stderr.
+	int failed() const { return failed_.load(std::memory_order_relaxed); }
+};
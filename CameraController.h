@@ -1,11 +1,8 @@
 #pragma once
 
-#include <SFML/Window/Keyboard.hpp>
-
+#include "Enums.h"
 #include "Matrix.h"
 
-using Key = sf::Keyboard::Key;
-
 class CameraController {
 public:
     Vector3<float> position;
@@ -13,10 +10,8 @@ public:
 
     CameraController() : position(0, 0, 5), rotation(0, 0, 0) {}
 
-    void handle_input() {
-        const float moveSpeed = 0.1f;
-        const float rotateSpeed = 0.02f;
-
+    // Camera-space basis derived from the current rotation.
+    void getBasis(Vector3<float>& forward, Vector3<float>& right, Vector3<float>& up) const {
         Matrix4 rot = Matrix4::rotate_y(rotation.y) * Matrix4::rotate_x(rotation.x);
 
         Vector4<float> localForward(0, 0, 1, 1);
@@ -25,21 +20,28 @@ public:
         Vector4<float> forward_h = (rot * localForward);
         Vector4<float> right_h = (rot * localRight);
 
-        Vector3<float> forward = Vector3<float>(forward_h.x, forward_h.y, forward_h.z).normalized();
-        Vector3<float> right = Vector3<float>(right_h.x, right_h.y, right_h.z).normalized();
-        Vector3<float> up = forward.cross(right);
-
-        if (isKeyPressed(Key::W)) position = position - forward * moveSpeed;
-        if (isKeyPressed(Key::S)) position = position + forward * moveSpeed;
-        if (isKeyPressed(Key::A)) position = position - right * moveSpeed;
-        if (isKeyPressed(Key::D)) position = position + right * moveSpeed;
-        if (isKeyPressed(Key::E)) position = position - up * moveSpeed;
-        if (isKeyPressed(Key::Q)) position = position + up * moveSpeed;
-
-        if (isKeyPressed(Key::Left))  rotation.y += rotateSpeed;
-        if (isKeyPressed(Key::Right)) rotation.y -= rotateSpeed;
-        if (isKeyPressed(Key::Up))    rotation.x += rotateSpeed;
-        if (isKeyPressed(Key::Down))  rotation.x -= rotateSpeed;
+        forward = Vector3<float>(forward_h.x, forward_h.y, forward_h.z).normalized();
+        right = Vector3<float>(right_h.x, right_h.y, right_h.z).normalized();
+        up = forward.cross(right);
+    }
+
+    Matrix4 getProjectionMatrix(ProjectionMode mode, float aspect) const {
+        if (mode == ProjectionMode::PERSPECTIVE) {
+            return Matrix4::perspective(
+                90.0f * 3.1415f / 180.0f,
+                aspect,
+                0.1f,
+                100.0f);
+        }
+        else {
+            float ortho_width = 10.0f;
+            float ortho_height = ortho_width / aspect;
+            return Matrix4::orthographic(
+                -ortho_width / 2, ortho_width / 2,
+                ortho_height / 2, -ortho_height / 2,
+                0.1f,
+                100.0f);
+        }
     }
 
     Matrix4 getViewMatrix() const {
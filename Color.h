@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+// RGBA8 color used by the renderer core; layout matches the framebuffer pixel format.
+struct Color {
+	uint8_t r = 0;
+	uint8_t g = 0;
+	uint8_t b = 0;
+	uint8_t a = 255;
+
+	constexpr Color() = default;
+	constexpr Color(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) : r(r), g(g), b(b), a(a) {}
+
+	constexpr bool operator==(const Color& other) const {
+		return r == other.r && g == other.g && b == other.b && a == other.a;
+	}
+	constexpr bool operator!=(const Color& other) const { return !(*this == other); }
+
+	static const Color Black;
+	static const Color White;
+};
+
+inline constexpr Color Color::Black{ 0, 0, 0 };
+inline constexpr Color Color::White{ 255, 255, 255 };
@@ -0,0 +1,334 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Enums.h"
+#include "Vector.h"
+
+// Screen-space depth setup of one triangle. Depth at a pixel is the harmonic blend of the
+// vertex depths by barycentric weight; the rasterizer and the depth buffer both go through
+// depth(), so a value recomputed from the plane matches the one that was tested bit for bit.
+struct DepthPlane {
+	Vector2<float> a, b, c;
+	float area;
+	float za, zb, zc;
+
+	float depth(float alpha, float beta, float gamma) const {
+		return 1.0f / (alpha / za + beta / zb + gamma / zc);
+	}
+
+	float at(int x, int y) const {
+		const Vector2<float> p(static_cast<float>(x), static_cast<float>(y));
+		return depth(edge(b, c, p) / area, edge(c, a, p) / area, edge(a, b, p) / area);
+	}
+
+	static float edge(const Vector2<float>& a, const Vector2<float>& b, const Vector2<float>& c) {
+		return (a.x - c.x) * (b.y - c.y) - (b.x - c.x) * (a.y - c.y);
+	}
+};
+
+// Per-pixel depth in one of several storage formats, smaller depth being closer:
+//   FLOAT32         32-bit float, cleared to FLT_MAX (the reference format).
+//   UNORM16         16-bit fixed point over [0, 1]; half the memory, visible z-fighting on
+//                   distant, nearly coplanar surfaces.
+//   UNORM24         24-bit fixed point packed into 3 bytes; a quarter less memory and
+//                   clear/test traffic than FLOAT32, with 256 times UNORM16's resolution.
+//
+// With tile compression on, each 8x8 tile starts out cleared and can describe its pixels
+// with up to two triangle planes plus a per-pixel mask saying which plane (if any) each
+// pixel takes its depth from. Tests in such a tile re-evaluate the plane instead of
+// reading per-pixel storage, and writes only update the mask. A third plane expands the
+// tile into per-pixel storage. Large triangles then cost a few bytes per tile instead of
+// 64 depth values, and clearing touches only the tile headers.
+//
+// Compression is off by default and only pays off for scenes of triangles much larger
+// than a tile, such as architecture or terrain seen up close. Each test in a planar tile
+// re-evaluates the plane, and every triangle that stays planar anywhere keeps its plane
+// until the next clear. Dense models expand most tiles: the bundled cow leaves 7 tiles
+// planar against 174 expanded, so there compression only adds work.
+class DepthBuffer {
+public:
+	static constexpr int kTileSize = 8;
+
+	struct TileStats {
+		size_t cleared = 0;
+		size_t planar = 0;
+		size_t expanded = 0;
+	};
+
+private:
+	struct Tile {
+		uint64_t mask[2] = { 0, 0 };	// bit j * 8 + i: pixel (i, j) uses plane[k]
+		uint32_t plane[2] = { 0, 0 };
+		bool expanded = false;
+	};
+
+	int width_ = 0;
+	int height_ = 0;
+	DepthFormat format_ = DepthFormat::FLOAT32;
+	bool compression_ = false;
+	std::vector<float> floats_;
+	std::vector<uint16_t> unorm16_;
+	std::vector<uint8_t> unorm24_;	// 3 bytes per pixel, little-endian
+
+	int tiles_x_ = 0;
+	std::vector<Tile> tiles_;
+	std::vector<DepthPlane> planes_;
+	bool last_plane_used_ = true;
+	size_t covered_ = 0;	// pixels a test has passed on since the last clear
+
+	static uint16_t to_unorm16(float z) {
+		return static_cast<uint16_t>(std::clamp(z, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+
+	static uint32_t to_unorm24(float z) {
+		return static_cast<uint32_t>(static_cast<double>(std::clamp(z, 0.0f, 1.0f)) * 16777215.0 + 0.5);
+	}
+
+	uint32_t load_unorm24(size_t index) const {
+		const uint8_t* p = &unorm24_[index * 3];
+		return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16;
+	}
+
+	void store_unorm24(size_t index, uint32_t code) {
+		uint8_t* p = &unorm24_[index * 3];
+		p[0] = static_cast<uint8_t>(code);
+		p[1] = static_cast<uint8_t>(code >> 8);
+		p[2] = static_cast<uint8_t>(code >> 16);
+	}
+
+	// Depth a cleared pixel compares as.
+	float clear_depth() const {
+		return format_ == DepthFormat::FLOAT32 ? std::numeric_limits<float>::max() : 1.0f;
+	}
+
+	// Whether z passes against a pixel holding reference, at the precision of the format.
+	bool closer(float z, float reference) const {
+		switch (format_) {
+		case DepthFormat::UNORM16: return to_unorm16(z) < to_unorm16(reference);
+		case DepthFormat::UNORM24: return to_unorm24(z) < to_unorm24(reference);
+		default: return z < reference;
+		}
+	}
+
+	void store(size_t index, float z) {
+		switch (format_) {
+		case DepthFormat::UNORM16: unorm16_[index] = to_unorm16(z); break;
+		case DepthFormat::UNORM24: store_unorm24(index, to_unorm24(z)); break;
+		default: floats_[index] = z; break;
+		}
+	}
+
+	// A passing test over a cleared value is the pixel's first cover since the clear.
+	bool test_and_store(size_t index, float z) {
+		switch (format_) {
+		case DepthFormat::UNORM16: {
+			const uint16_t code = to_unorm16(z);
+			if (!(code < unorm16_[index])) return false;
+			covered_ += unorm16_[index] == 0xFFFF;
+			unorm16_[index] = code;
+			return true;
+		}
+		case DepthFormat::UNORM24: {
+			const uint32_t code = to_unorm24(z);
+			const uint32_t stored = load_unorm24(index);
+			if (!(code < stored)) return false;
+			covered_ += stored == 0xFFFFFF;
+			store_unorm24(index, code);
+			return true;
+		}
+		default:
+			if (!(z < floats_[index])) return false;
+			covered_ += floats_[index] == std::numeric_limits<float>::max();
+			floats_[index] = z;
+			return true;
+		}
+	}
+
+	float load(size_t index) const {
+		switch (format_) {
+		case DepthFormat::UNORM16: return static_cast<float>(unorm16_[index]) / 65535.0f;
+		case DepthFormat::UNORM24: return static_cast<float>(static_cast<double>(load_unorm24(index)) / 16777215.0);
+		default: return floats_[index];
+		}
+	}
+
+	void fill_clear(size_t first, size_t count) {
+		switch (format_) {
+		case DepthFormat::UNORM16: std::fill_n(unorm16_.begin() + first, count, uint16_t(0xFFFF)); break;
+		case DepthFormat::UNORM24: std::fill_n(unorm24_.begin() + first * 3, count * 3, uint8_t(0xFF)); break;
+		default: std::fill_n(floats_.begin() + first, count, std::numeric_limits<float>::max()); break;
+		}
+	}
+
+	Tile& tile_at(int x, int y) {
+		return tiles_[static_cast<size_t>(y / kTileSize) * tiles_x_ + x / kTileSize];
+	}
+
+	const Tile& tile_at(int x, int y) const {
+		return tiles_[static_cast<size_t>(y / kTileSize) * tiles_x_ + x / kTileSize];
+	}
+
+	static uint64_t tile_bit(int x, int y) {
+		return uint64_t(1) << ((y % kTileSize) * kTileSize + x % kTileSize);
+	}
+
+	float tile_depth(const Tile& tile, int x, int y) const {
+		const uint64_t bit = tile_bit(x, y);
+		if (tile.mask[0] & bit) return planes_[tile.plane[0]].at(x, y);
+		if (tile.mask[1] & bit) return planes_[tile.plane[1]].at(x, y);
+		return clear_depth();
+	}
+
+	// Writes the tile's planes out to per-pixel storage.
+	void expand(Tile& tile, int x, int y) {
+		const int x0 = x - x % kTileSize;
+		const int y0 = y - y % kTileSize;
+		for (int py = y0; py < std::min(y0 + kTileSize, height_); ++py) {
+			const size_t row = static_cast<size_t>(py) * width_;
+			for (int px = x0; px < std::min(x0 + kTileSize, width_); ++px) {
+				const uint64_t bit = tile_bit(px, py);
+				if (tile.mask[0] & bit) store(row + px, planes_[tile.plane[0]].at(px, py));
+				else if (tile.mask[1] & bit) store(row + px, planes_[tile.plane[1]].at(px, py));
+				else fill_clear(row + px, 1);
+			}
+		}
+		tile.mask[0] = tile.mask[1] = 0;
+		tile.expanded = true;
+	}
+
+	bool test_and_set_tiled(int x, int y, float z) {
+		Tile& tile = tile_at(x, y);
+		const size_t index = static_cast<size_t>(y) * width_ + x;
+		if (tile.expanded) return test_and_store(index, z);
+		if (!closer(z, tile_depth(tile, x, y))) return false;
+
+		const uint64_t bit = tile_bit(x, y);
+		covered_ += !((tile.mask[0] | tile.mask[1]) & bit);
+		tile.mask[0] &= ~bit;
+		tile.mask[1] &= ~bit;
+		// Only a value that the current plane reproduces exactly may be kept as a plane.
+		if (!planes_.empty() && planes_.back().at(x, y) == z) {
+			const uint32_t current = static_cast<uint32_t>(planes_.size() - 1);
+			for (int k = 0; k < 2; ++k) {
+				if (tile.mask[k] && tile.plane[k] == current) {
+					tile.mask[k] |= bit;
+					return true;
+				}
+			}
+			for (int k = 0; k < 2; ++k) {
+				if (!tile.mask[k]) {
+					tile.plane[k] = current;
+					tile.mask[k] = bit;
+					last_plane_used_ = true;
+					return true;
+				}
+			}
+		}
+		expand(tile, x, y);
+		store(index, z);
+		return true;
+	}
+
+	void allocate() {
+		const size_t count = static_cast<size_t>(width_) * height_;
+		floats_.assign(format_ == DepthFormat::FLOAT32 ? count : 0, 0.0f);
+		unorm16_.assign(format_ == DepthFormat::UNORM16 ? count : 0, 0);
+		unorm24_.assign(format_ == DepthFormat::UNORM24 ? count * 3 : 0, 0);
+		tiles_x_ = compression_ ? (width_ + kTileSize - 1) / kTileSize : 0;
+		tiles_.assign(compression_ ? static_cast<size_t>(tiles_x_) * ((height_ + kTileSize - 1) / kTileSize) : 0, Tile());
+		clear();
+	}
+
+public:
+	DepthBuffer(int width = 0, int height = 0, DepthFormat format = DepthFormat::FLOAT32, bool compression = false)
+		: width_(width), height_(height), format_(format), compression_(compression) {
+		allocate();
+	}
+
+	void resize(int width, int height) {
+		if (width == width_ && height == height_) return;
+		width_ = width;
+		height_ = height;
+		allocate();
+	}
+
+	// Reallocates (and clears) only when something changes.
+	void set_format(DepthFormat format, bool compression = false) {
+		if (format == format_ && compression == compression_) return;
+		format_ = format;
+		compression_ = compression;
+		allocate();
+	}
+
+	int width() const { return width_; }
+	int height() const { return height_; }
+	DepthFormat format() const { return format_; }
+	bool compression() const { return compression_; }
+
+	size_t bytes_per_pixel() const {
+		switch (format_) {
+		case DepthFormat::UNORM16: return 2;
+		case DepthFormat::UNORM24: return 3;
+		default: return 4;
+		}
+	}
+
+	void clear() {
+		covered_ = 0;
+		if (compression_) {
+			std::fill(tiles_.begin(), tiles_.end(), Tile());
+			planes_.clear();
+			last_plane_used_ = true;
+			return;
+		}
+		fill_clear(0, static_cast<size_t>(width_) * height_);
+	}
+
+	// Names the triangle whose depths the following test_and_set calls carry. Only tile
+	// compression needs it; a plane no tile ended up using is overwritten by the next one.
+	void begin_triangle(const DepthPlane& plane) {
+		if (!compression_) return;
+		if (last_plane_used_) planes_.push_back(plane);
+		else planes_.back() = plane;
+		last_plane_used_ = false;
+	}
+
+	// Depth test at (x, y), which must lie inside the buffer; stores z and returns true if
+	// it passes.
+	bool test_and_set(int x, int y, float z) {
+		if (compression_) return test_and_set_tiled(x, y, z);
+		return test_and_store(static_cast<size_t>(y) * width_ + x, z);
+	}
+
+	// Stored depth at (x, y) as a float at the format's precision; clear_value() if untouched.
+	float depth_at(int x, int y) const {
+		if (compression_ && !tile_at(x, y).expanded) {
+			const float z = tile_depth(tile_at(x, y), x, y);
+			switch (format_) {
+			case DepthFormat::UNORM16: return static_cast<float>(to_unorm16(z)) / 65535.0f;
+			case DepthFormat::UNORM24: return static_cast<float>(static_cast<double>(to_unorm24(z)) / 16777215.0);
+			default: return z;
+			}
+		}
+		return load(static_cast<size_t>(y) * width_ + x);
+	}
+
+	float clear_value() const { return clear_depth(); }
+
+	// Pixels written since the last clear, counted as tests pass rather than by a scan.
+	size_t covered_pixels() const { return covered_; }
+
+	TileStats tile_stats() const {
+		TileStats stats;
+		for (const auto& tile : tiles_) {
+			if (tile.expanded) ++stats.expanded;
+			else if (tile.mask[0] | tile.mask[1]) ++stats.planar;
+			else ++stats.cleared;
+		}
+		return stats;
+	}
+};
@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "DepthBuffer.h"
+#include "FrameArena.h"
+#include "Framebuffer.h"
+
+// Low-resolution color/depth pair the scene is rendered into before upscaling.
+struct RenderTarget {
+	std::unique_ptr<Framebuffer> framebuffer;
+	DepthBuffer depth;
+};
+
+// Picks the internal render scale each frame so that frame time stays under a budget.
+// Raster cost is roughly proportional to the pixel count, so the controller solves
+// scale' = scale * sqrt(budget / measured) on a short moving average, stepping down
+// as far as needed at once but back up one step at a time to avoid oscillation.
+class DynamicResolution {
+public:
+	static constexpr size_t kHistorySize = 64;
+	static constexpr size_t kAverageWindow = 8;
+	static constexpr float kStep = 1.0f / 16.0f;
+
+private:
+	float budget_ms_;
+	float min_scale_;
+	float max_scale_;
+	float scale_;
+	std::array<float, kHistorySize> history_{};
+	size_t history_count_ = 0;
+	size_t history_next_ = 0;
+	int cooldown_ = 0;
+	std::map<uint64_t, RenderTarget> targets_;
+
+	static float quantize(float scale) {
+		return std::round(scale / kStep) * kStep;
+	}
+
+public:
+	explicit DynamicResolution(float budget_ms = 16.6f, float min_scale = 0.5f, float max_scale = 1.0f)
+		: budget_ms_(budget_ms), min_scale_(min_scale), max_scale_(max_scale), scale_(max_scale) {
+	}
+
+	void set_budget_ms(float budget_ms) { budget_ms_ = budget_ms; }
+	float budget_ms() const { return budget_ms_; }
+	float scale() const { return scale_; }
+
+	// Mean of the most recent frames (at most kAverageWindow).
+	float average_ms() const {
+		const size_t count = std::min(history_count_, kAverageWindow);
+		if (count == 0) return 0.0f;
+		float sum = 0.0f;
+		for (size_t i = 1; i <= count; ++i)
+			sum += history_[(history_next_ + kHistorySize - i) % kHistorySize];
+		return sum / static_cast<float>(count);
+	}
+
+	// Frame times in milliseconds, oldest first.
+	std::vector<float> history() const {
+		std::vector<float> result;
+		result.reserve(history_count_);
+		const size_t first = (history_next_ + kHistorySize - history_count_) % kHistorySize;
+		for (size_t i = 0; i < history_count_; ++i)
+			result.push_back(history_[(first + i) % kHistorySize]);
+		return result;
+	}
+
+	// Feed the CPU time of the frame just rendered; updates scale() for the next one.
+	void record_frame(float frame_ms) {
+		history_[history_next_] = frame_ms;
+		history_next_ = (history_next_ + 1) % kHistorySize;
+		history_count_ = std::min(history_count_ + 1, kHistorySize);
+
+		// After a change, wait until the average only covers frames at the new scale.
+		if (cooldown_ > 0) {
+			--cooldown_;
+			return;
+		}
+
+		const float average = average_ms();
+		if (average <= 0.0f) return;
+
+		const float ideal = scale_ * std::sqrt(budget_ms_ * 0.9f / average);
+		float next = scale_;
+		if (average > budget_ms_)
+			next = std::floor(ideal / kStep) * kStep;
+		else if (average < budget_ms_ * 0.75f && ideal >= scale_ + kStep)
+			next = scale_ + kStep;
+
+		next = std::clamp(quantize(next), min_scale_, max_scale_);
+		if (next != scale_) {
+			scale_ = next;
+			cooldown_ = static_cast<int>(kAverageWindow);
+		}
+	}
+
+	// Internal target for the current scale at the given output size. Targets are kept
+	// per size, so revisiting a scale does not allocate.
+	RenderTarget& target(unsigned int output_width, unsigned int output_height) {
+		const auto width = std::max(1u, static_cast<unsigned int>(std::lround(output_width * scale_)));
+		const auto height = std::max(1u, static_cast<unsigned int>(std::lround(output_height * scale_)));
+		RenderTarget& target = targets_[static_cast<uint64_t>(width) << 32 | height];
+		if (!target.framebuffer) {
+			target.framebuffer = std::make_unique<Framebuffer>(width, height);
+			target.depth.resize(static_cast<int>(width), static_cast<int>(height));
+		}
+		return target;
+	}
+};
+
+// Bilinear resample of the whole of source onto the whole of destination, 8-bit weights.
+// The per-column lookup tables come from scratch, normally the frame arena.
+inline void upscale_bilinear(const Framebuffer& source, Framebuffer& destination, LinearArena& scratch) {
+	const unsigned int sw = source.get_width();
+	const unsigned int sh = source.get_height();
+	const unsigned int dw = destination.get_width();
+	const unsigned int dh = destination.get_height();
+	const uint8_t* src = source.data();
+	uint8_t* dst = destination.data();
+
+	// 16.16 fixed-point source coordinate of each destination pixel centre.
+	const int64_t step_x = (static_cast<int64_t>(sw) << 16) / dw;
+	const int64_t step_y = (static_cast<int64_t>(sh) << 16) / dh;
+
+	int* x0 = scratch.allocate_array<int>(dw);
+	int* x1 = scratch.allocate_array<int>(dw);
+	int* fx = scratch.allocate_array<int>(dw);
+	for (unsigned int x = 0; x < dw; ++x) {
+		const int64_t sx = std::max<int64_t>(0, (x * step_x + step_x / 2) - (1 << 15));
+		x0[x] = std::min(static_cast<int>(sx >> 16), static_cast<int>(sw) - 1);
+		x1[x] = std::min(x0[x] + 1, static_cast<int>(sw) - 1);
+		fx[x] = static_cast<int>((sx >> 8) & 0xFF);
+	}
+
+	for (unsigned int y = 0; y < dh; ++y) {
+		const int64_t sy = std::max<int64_t>(0, (y * step_y + step_y / 2) - (1 << 15));
+		const int y0 = std::min(static_cast<int>(sy >> 16), static_cast<int>(sh) - 1);
+		const int y1 = std::min(y0 + 1, static_cast<int>(sh) - 1);
+		const int fy = static_cast<int>((sy >> 8) & 0xFF);
+		const uint8_t* row0 = src + static_cast<size_t>(y0) * sw * 4;
+		const uint8_t* row1 = src + static_cast<size_t>(y1) * sw * 4;
+		uint8_t* out = dst + static_cast<size_t>(y) * dw * 4;
+
+		for (unsigned int x = 0; x < dw; ++x) {
+			const uint8_t* a = row0 + x0[x] * 4;
+			const uint8_t* b = row0 + x1[x] * 4;
+			const uint8_t* c = row1 + x0[x] * 4;
+			const uint8_t* d = row1 + x1[x] * 4;
+			const int wx = fx[x];
+			for (int channel = 0; channel < 4; ++channel) {
+				const int top = a[channel] * (256 - wx) + b[channel] * wx;
+				const int bottom = c[channel] * (256 - wx) + d[channel] * wx;
+				out[x * 4 + channel] = static_cast<uint8_t>((top * (256 - fy) + bottom * fy + (1 << 15)) >> 16);
+			}
+		}
+	}
+}
@@ -10,3 +10,14 @@ enum class ProjectionMode {
 	PERSPECTIVE,
 	ORTHOGRAPHIC
 };
+
+enum class DrawOrder {
+	SUBMISSION,
+	FRONT_TO_BACK
+};
+
+enum class DepthFormat {
+	FLOAT32,
+	UNORM16,
+	UNORM24
+};
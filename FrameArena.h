@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Bump allocator for data that lives for a single frame. Allocation is a pointer
+// increment; nothing is freed individually. When a frame overflows the current block a
+// new block is chained on, and the next reset() replaces the chain with one block sized
+// from the high-water mark, so a steady workload stops touching the heap after warm-up.
+class LinearArena {
+	static constexpr size_t kAlignment = 64;
+	static constexpr size_t kGranularity = 64 * 1024;
+
+	struct Block {
+		std::byte* data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks_;
+	size_t offset_ = 0;
+	size_t used_ = 0;
+	size_t high_water_ = 0;
+	size_t overflow_count_ = 0;
+
+	static Block allocate_block(size_t size) {
+		size = (size + kGranularity - 1) / kGranularity * kGranularity;
+		return { static_cast<std::byte*>(::operator new(size, std::align_val_t{ kAlignment })), size };
+	}
+
+	static void free_block(const Block& block) {
+		::operator delete(block.data, std::align_val_t{ kAlignment });
+	}
+
+	void release() {
+		for (const auto& block : blocks_)
+			free_block(block);
+		blocks_.clear();
+	}
+
+public:
+	explicit LinearArena(size_t initial_size = 256 * 1024) {
+		blocks_.reserve(8);
+		blocks_.push_back(allocate_block(initial_size));
+	}
+
+	~LinearArena() { release(); }
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+		Block* block = &blocks_.back();
+		size_t start = (offset_ + alignment - 1) & ~(alignment - 1);
+		if (start + bytes > block->size) {
+			++overflow_count_;
+			blocks_.push_back(allocate_block(std::max(bytes + alignment, block->size * 2)));
+			block = &blocks_.back();
+			start = 0;
+		}
+		offset_ = start + bytes;
+		used_ += bytes;
+		high_water_ = std::max(high_water_, used_);
+		return block->data + start;
+	}
+
+	template<typename T>
+	T* allocate_array(size_t count) {
+		return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// Rewinds to empty. If the last frame needed more than one block, the chain is
+	// collapsed into a single block big enough for the high-water mark plus headroom.
+	void reset() {
+		if (blocks_.size() > 1) {
+			release();
+			blocks_.push_back(allocate_block(high_water_ + high_water_ / 4));
+		}
+		offset_ = 0;
+		used_ = 0;
+	}
+
+	size_t used() const { return used_; }
+	size_t high_water() const { return high_water_; }
+	size_t overflow_count() const { return overflow_count_; }
+
+	size_t capacity() const {
+		size_t total = 0;
+		for (const auto& block : blocks_)
+			total += block.size;
+		return total;
+	}
+};
+
+// STL allocator adapter; deallocate is a no-op because the arena is reset wholesale.
+template<typename T>
+class ArenaAllocator {
+	template<typename U> friend class ArenaAllocator;
+	LinearArena* arena_;
+
+public:
+	using value_type = T;
+
+	explicit ArenaAllocator(LinearArena& arena) noexcept : arena_(&arena) {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena_) {}
+
+	T* allocate(size_t n) { return arena_->allocate_array<T>(n); }
+	void deallocate(T*, size_t) noexcept {}
+
+	LinearArena& arena() const { return *arena_; }
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena_; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena_ != other.arena_; }
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Per-frame scratch memory for the pipeline, reset at the start of each frame. Every
+// stage that allocates per frame runs on the render thread (the radix sort's helper
+// threads only work inside buffers the caller allocated), so one arena serves them all.
+class FrameArena {
+	LinearArena main_;
+
+public:
+	struct Stats {
+		size_t used = 0;
+		size_t high_water = 0;
+		size_t capacity = 0;
+		size_t overflow_count = 0;
+	};
+
+	explicit FrameArena(size_t initial_size = 1024 * 1024)
+		: main_(initial_size) {
+	}
+
+	void begin_frame() { main_.reset(); }
+
+	LinearArena& main() { return main_; }
+
+	template<typename T>
+	ArenaVector<T> make_vector(size_t reserve = 0) {
+		ArenaVector<T> result{ ArenaAllocator<T>(main_) };
+		result.reserve(reserve);
+		return result;
+	}
+
+	Stats stats() const {
+		return { main_.used(), main_.high_water(), main_.capacity(), main_.overflow_count() };
+	}
+};
@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Framebuffer.h"
+#include "ImageWriter.h"
+
+// Records finished frames to an image sequence without stalling the render loop.
+// submit() swaps the framebuffer's pixel storage with a recycled buffer and queues the
+// filled one for a pool of encoder threads. The pool of buffers is bounded, so when
+// encoding falls behind submit() waits for a buffer to come back (backpressure)
+// rather than growing memory without limit.
+class FrameCapture {
+public:
+	struct Stats {
+		uint64_t submitted = 0;
+		uint64_t written = 0;
+		uint64_t failed = 0;
+		uint64_t stalls = 0;
+		double stall_ms = 0.0;
+	};
+
+private:
+	struct Job {
+		uint64_t index;
+		std::unique_ptr<uint8_t[]> pixels;
+	};
+
+	std::string directory_;
+	ImageFormat format_;
+	unsigned int width_;
+	unsigned int height_;
+
+	std::vector<std::thread> encoders_;
+	// Guards the job queue, the buffer pool, timestamps_ and stats_: submit() usually runs
+	// on a presenter thread while the window reads stats() for its title.
+	mutable std::mutex mutex_;
+	std::condition_variable work_cv_;
+	std::condition_variable free_cv_;
+	std::deque<Job> jobs_;
+	std::vector<std::unique_ptr<uint8_t[]>> free_buffers_;
+	bool stopping_ = false;
+
+	std::chrono::steady_clock::time_point start_;
+	std::vector<double> timestamps_;
+	Stats stats_;
+	std::atomic<uint64_t> written_{ 0 };
+	std::atomic<uint64_t> failed_{ 0 };
+
+	std::string frame_path(uint64_t index) const {
+		char name[32];
+		std::snprintf(name, sizeof(name), "frame_%06llu", static_cast<unsigned long long>(index));
+		return directory_ + "/" + name + image_writer::extension(format_);
+	}
+
+	void encoder_loop() {
+		std::vector<uint8_t> encoded;
+		while (true) {
+			Job job;
+			{
+				std::unique_lock lock(mutex_);
+				work_cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+				if (jobs_.empty()) return;
+				job = std::move(jobs_.front());
+				jobs_.pop_front();
+			}
+
+			image_writer::encode(format_, job.pixels.get(), width_, height_, encoded);
+			if (image_writer::write_file(frame_path(job.index), encoded))
+				written_.fetch_add(1, std::memory_order_relaxed);
+			else
+				failed_.fetch_add(1, std::memory_order_relaxed);
+
+			{
+				std::lock_guard lock(mutex_);
+				free_buffers_.push_back(std::move(job.pixels));
+			}
+			free_cv_.notify_one();
+		}
+	}
+
+	void write_timestamps() const {
+		std::lock_guard lock(mutex_);
+		std::ofstream file(directory_ + "/timestamps.csv");
+		file << "frame,seconds\n";
+		for (size_t i = 0; i < timestamps_.size(); ++i)
+			file << i << "," << timestamps_[i] << "\n";
+	}
+
+public:
+	// max_in_flight bounds how many captured frames may wait for encoding at once.
+	FrameCapture(std::string directory, ImageFormat format, unsigned int width, unsigned int height,
+		unsigned int encoder_threads = 0, size_t max_in_flight = 8)
+		: directory_(std::move(directory)), format_(format), width_(width), height_(height),
+		start_(std::chrono::steady_clock::now()) {
+		std::filesystem::create_directories(directory_);
+
+		if (encoder_threads == 0)
+			encoder_threads = std::max(2u, std::thread::hardware_concurrency() / 2) - 1;
+		max_in_flight = std::max<size_t>(max_in_flight, 1);
+
+		const size_t frame_bytes = static_cast<size_t>(width_) * height_ * 4;
+		for (size_t i = 0; i < max_in_flight; ++i)
+			free_buffers_.push_back(std::make_unique<uint8_t[]>(frame_bytes));
+		for (unsigned int i = 0; i < encoder_threads; ++i)
+			encoders_.emplace_back(&FrameCapture::encoder_loop, this);
+	}
+
+	~FrameCapture() { finish(); }
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// Takes ownership of the framebuffer's current contents; the framebuffer is left
+	// holding a recycled buffer with undefined contents. Returns false on size mismatch.
+	bool submit(Framebuffer& framebuffer) {
+		if (framebuffer.get_width() != width_ || framebuffer.get_height() != height_)
+			return false;
+
+		const auto now = std::chrono::steady_clock::now();
+		std::unique_ptr<uint8_t[]> buffer;
+		{
+			std::unique_lock lock(mutex_);
+			if (free_buffers_.empty()) {
+				++stats_.stalls;
+				free_cv_.wait(lock, [this] { return !free_buffers_.empty(); });
+				stats_.stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count();
+			}
+			buffer = std::move(free_buffers_.back());
+			free_buffers_.pop_back();
+		}
+
+		auto filled = framebuffer.swap_pixels(std::move(buffer));
+		{
+			std::lock_guard lock(mutex_);
+			const uint64_t index = stats_.submitted++;
+			timestamps_.push_back(std::chrono::duration<double>(now - start_).count());
+			jobs_.push_back({ index, std::move(filled) });
+		}
+		work_cv_.notify_one();
+		return true;
+	}
+
+	// Drains the queue, stops the encoders and writes timestamps.csv. Idempotent.
+	void finish() {
+		{
+			std::lock_guard lock(mutex_);
+			if (stopping_) return;
+			stopping_ = true;
+		}
+		work_cv_.notify_all();
+		for (auto& encoder : encoders_)
+			encoder.join();
+		encoders_.clear();
+		write_timestamps();
+	}
+
+	// Safe to call from any thread while another submits.
+	Stats stats() const {
+		std::lock_guard lock(mutex_);
+		Stats result = stats_;
+		result.written = written_.load(std::memory_order_relaxed);
+		result.failed = failed_.load(std::memory_order_relaxed);
+		return result;
+	}
+
+	const std::string& directory() const { return directory_; }
+};
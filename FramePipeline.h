@@ -0,0 +1,172 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Framebuffer.h"
+
+// Overlaps presenting one frame with rendering the next. The pipeline owns
+// frames_in_flight framebuffers: the render thread takes a free one with begin_frame(),
+// draws into it and hands it over with end_frame(); a presenter thread shows queued
+// frames in order and returns their buffers. With one buffer this is the serial loop;
+// with two or three, throughput is bounded by the slower of rendering and presenting
+// rather than by their sum, at the cost of up to frames_in_flight - 1 frames of latency.
+class FramePipeline {
+public:
+	struct Callbacks {
+		// On the presenter thread before the first and after the last frame, e.g. to
+		// take and release a graphics context.
+		std::function<void()> begin;
+		std::function<void()> end;
+		// Shows a finished frame. The buffer is reused afterwards, so anything that keeps
+		// the pixels must copy or take them here.
+		std::function<void(Framebuffer&)> present;
+		// Shows the most recently presented frame again.
+		std::function<void()> redisplay;
+	};
+
+	struct Stats {
+		uint64_t rendered = 0;
+		uint64_t presented = 0;
+		uint64_t render_stalls = 0;	// begin_frame() waited for a buffer
+		double render_stall_ms = 0.0;
+		double present_ms = 0.0;
+	};
+
+private:
+	Callbacks callbacks_;
+	std::vector<std::unique_ptr<Framebuffer>> buffers_;
+	std::deque<Framebuffer*> free_;
+	std::deque<Framebuffer*> queued_;
+	Framebuffer* rendering_ = nullptr;
+	bool presenting_ = false;
+	bool redisplay_ = false;
+	bool stopping_ = false;
+	Stats stats_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable work_cv_;
+	std::condition_variable free_cv_;
+	std::thread presenter_;
+
+	void presenter_loop() {
+		if (callbacks_.begin) callbacks_.begin();
+		while (true) {
+			Framebuffer* frame = nullptr;
+			bool redisplay = false;
+			{
+				std::unique_lock lock(mutex_);
+				work_cv_.wait(lock, [this] { return stopping_ || redisplay_ || !queued_.empty(); });
+				if (!queued_.empty()) {
+					frame = queued_.front();
+					queued_.pop_front();
+					redisplay_ = false;
+				}
+				else if (redisplay_) {
+					redisplay = true;
+					redisplay_ = false;
+				}
+				else {
+					break;
+				}
+				presenting_ = true;
+			}
+
+			const auto start = std::chrono::steady_clock::now();
+			if (frame && callbacks_.present) callbacks_.present(*frame);
+			else if (redisplay && callbacks_.redisplay) callbacks_.redisplay();
+			const double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			{
+				std::lock_guard lock(mutex_);
+				presenting_ = false;
+				if (frame) {
+					free_.push_back(frame);
+					++stats_.presented;
+					stats_.present_ms += elapsed;
+				}
+			}
+			free_cv_.notify_all();
+		}
+		if (callbacks_.end) callbacks_.end();
+	}
+
+public:
+	FramePipeline(unsigned int width, unsigned int height, int frames_in_flight, Callbacks callbacks)
+		: callbacks_(std::move(callbacks)) {
+		frames_in_flight = std::clamp(frames_in_flight, 1, 3);
+		for (int i = 0; i < frames_in_flight; ++i) {
+			buffers_.push_back(std::make_unique<Framebuffer>(width, height));
+			free_.push_back(buffers_.back().get());
+		}
+		presenter_ = std::thread(&FramePipeline::presenter_loop, this);
+	}
+
+	// Presents whatever is still queued, then stops the presenter.
+	~FramePipeline() {
+		{
+			std::lock_guard lock(mutex_);
+			stopping_ = true;
+		}
+		work_cv_.notify_all();
+		presenter_.join();
+	}
+
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	int frames_in_flight() const { return static_cast<int>(buffers_.size()); }
+
+	// Blocks until a buffer is free. Its contents are whatever it last presented.
+	Framebuffer& begin_frame() {
+		std::unique_lock lock(mutex_);
+		if (free_.empty()) {
+			const auto start = std::chrono::steady_clock::now();
+			++stats_.render_stalls;
+			free_cv_.wait(lock, [this] { return !free_.empty(); });
+			stats_.render_stall_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		rendering_ = free_.front();
+		free_.pop_front();
+		return *rendering_;
+	}
+
+	// Queues the buffer from begin_frame() for presenting.
+	void end_frame() {
+		{
+			std::lock_guard lock(mutex_);
+			queued_.push_back(rendering_);
+			rendering_ = nullptr;
+			++stats_.rendered;
+		}
+		work_cv_.notify_one();
+	}
+
+	// Shows the last presented frame again; dropped if a new frame is already queued.
+	void redisplay() {
+		{
+			std::lock_guard lock(mutex_);
+			redisplay_ = true;
+		}
+		work_cv_.notify_one();
+	}
+
+	// Waits until every queued frame has been presented and the presenter is idle, e.g.
+	// before changing state the present callback reads.
+	void flush() {
+		std::unique_lock lock(mutex_);
+		free_cv_.wait(lock, [this] { return queued_.empty() && !presenting_; });
+	}
+
+	Stats stats() const {
+		std::lock_guard lock(mutex_);
+		return stats_;
+	}
+};
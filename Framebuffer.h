@@ -1,22 +1,23 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <memory>
+
+#include "Color.h"
 
 class Framebuffer {
 public:
-    Framebuffer(unsigned int width, unsigned int height)
-        : width(width), height(height), texture(sf::Vector2u(width, height)), sprite(texture) {
-        const size_t pixelCount = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
-        pixels = new uint8_t[pixelCount];
-        memset(pixels, 0, pixelCount);
-    }
+    Framebuffer(const Framebuffer&) = delete;
+    Framebuffer& operator=(const Framebuffer&) = delete;
 
-    ~Framebuffer() {
-        delete[] pixels;
+    Framebuffer(unsigned int width, unsigned int height)
+        : width(width), height(height) {
+        pixels = std::make_unique<uint8_t[]>(size_bytes());
     }
 
-    void clear(const sf::Color& color) const {
+    void clear(const Color& color) const {
         for (unsigned int y = 0; y < height; ++y) {
             for (unsigned int x = 0; x < width; ++x) {
                 set_pixel(x, y, color);
@@ -24,7 +25,7 @@ public:
         }
     }
 
-	void set_pixel(const unsigned int x, const unsigned int y, const sf::Color& color = sf::Color::White) const
+	void set_pixel(const unsigned int x, const unsigned int y, const Color& color = Color::White) const
 	{
         if (x < 0 || x >= width ||
             y < 0 || y >= height) return;
@@ -36,7 +37,7 @@ public:
         pixels[index + 3] = color.a;
     }
 
-    void draw_line(int x0, int y0, int x1, int y1, bool aa = false, const sf::Color& color = sf::Color::White) const
+    void draw_line(int x0, int y0, int x1, int y1, bool aa = false, const Color& color = Color::White) const
     {
         if (!aa)
         {
@@ -64,9 +65,16 @@ public:
         }
     }
 
-    void display(sf::RenderWindow* window) {
-        texture.update(pixels);
-        window->draw(sprite);
+    // RGBA8, row-major, width * height * 4 bytes.
+    const uint8_t* data() const { return pixels.get(); }
+    uint8_t* data() { return pixels.get(); }
+    size_t size_bytes() const { return static_cast<size_t>(width) * static_cast<size_t>(height) * 4; }
+
+    // Hands the current pixel storage to the caller in exchange for a buffer of the same
+    // size, so a finished frame can be kept without copying it.
+    std::unique_ptr<uint8_t[]> swap_pixels(std::unique_ptr<uint8_t[]> replacement) {
+        std::swap(pixels, replacement);
+        return replacement;
     }
 
     unsigned int get_width() const { return width; }
@@ -74,7 +82,5 @@ public:
 
 private:
     unsigned int width, height;
-    uint8_t* pixels;
-    sf::Texture texture;
-    sf::Sprite sprite;
+    std::unique_ptr<uint8_t[]> pixels;
 };
@@ -0,0 +1,197 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum class ImageFormat {
+	PPM,
+	PNG,
+	QOI
+};
+
+// Encoders for RGBA8 framebuffer contents. Alpha is dropped: the framebuffer is opaque.
+namespace image_writer {
+
+inline const char* extension(ImageFormat format) {
+	switch (format) {
+	case ImageFormat::PPM: return ".ppm";
+	case ImageFormat::PNG: return ".png";
+	case ImageFormat::QOI: return ".qoi";
+	}
+	return "";
+}
+
+inline void put_u32_be(std::vector<uint8_t>& out, uint32_t value) {
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+inline void encode_ppm(const uint8_t* rgba, unsigned int width, unsigned int height, std::vector<uint8_t>& out) {
+	const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+	const size_t count = static_cast<size_t>(width) * height;
+	out.clear();
+	out.reserve(header.size() + count * 3);
+	out.insert(out.end(), header.begin(), header.end());
+	for (size_t i = 0; i < count; ++i)
+		out.insert(out.end(), rgba + i * 4, rgba + i * 4 + 3);
+}
+
+// https://qoiformat.org/qoi-specification.pdf, 3 channels.
+inline void encode_qoi(const uint8_t* rgba, unsigned int width, unsigned int height, std::vector<uint8_t>& out) {
+	struct Pixel { uint8_t r, g, b; };
+	const size_t count = static_cast<size_t>(width) * height;
+	out.clear();
+	out.reserve(14 + count * 2);
+	out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+	put_u32_be(out, width);
+	put_u32_be(out, height);
+	out.push_back(3);
+	out.push_back(0);
+
+	std::array<Pixel, 64> index{};
+	Pixel previous{ 0, 0, 0 };
+	int run = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		const Pixel pixel{ rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2] };
+		if (pixel.r == previous.r && pixel.g == previous.g && pixel.b == previous.b) {
+			if (++run == 62 || i + 1 == count) {
+				out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+				run = 0;
+			}
+			continue;
+		}
+		if (run > 0) {
+			out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+			run = 0;
+		}
+
+		const int hash = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + 255 * 11) % 64;
+		const Pixel& cached = index[hash];
+		if (cached.r == pixel.r && cached.g == pixel.g && cached.b == pixel.b) {
+			out.push_back(static_cast<uint8_t>(hash));
+		}
+		else {
+			index[hash] = pixel;
+			const int dr = static_cast<int8_t>(pixel.r - previous.r);
+			const int dg = static_cast<int8_t>(pixel.g - previous.g);
+			const int db = static_cast<int8_t>(pixel.b - previous.b);
+			const int dr_dg = dr - dg;
+			const int db_dg = db - dg;
+			if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+				out.push_back(static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+			}
+			else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+				out.push_back(static_cast<uint8_t>(0x80 | (dg + 32)));
+				out.push_back(static_cast<uint8_t>((dr_dg + 8) << 4 | (db_dg + 8)));
+			}
+			else {
+				out.insert(out.end(), { 0xFE, pixel.r, pixel.g, pixel.b });
+			}
+		}
+		previous = pixel;
+	}
+	out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> result{};
+		for (uint32_t n = 0; n < 256; ++n) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			result[n] = c;
+		}
+		return result;
+	}();
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+// PNG with stored (uncompressed) deflate blocks: encoding is a memcpy per row, so the
+// encoder threads keep up with the rasterizer. Use QOI when file size matters.
+inline void encode_png(const uint8_t* rgba, unsigned int width, unsigned int height, std::vector<uint8_t>& out) {
+	auto put_chunk = [&out](const char* type, const std::vector<uint8_t>& data) {
+		put_u32_be(out, static_cast<uint32_t>(data.size()));
+		const size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		put_u32_be(out, crc32(out.data() + start, out.size() - start));
+	};
+
+	std::vector<uint8_t> raw;
+	const size_t row_size = static_cast<size_t>(width) * 3 + 1;
+	raw.reserve(row_size * height);
+	for (unsigned int y = 0; y < height; ++y) {
+		raw.push_back(0);
+		const uint8_t* row = rgba + static_cast<size_t>(y) * width * 4;
+		for (unsigned int x = 0; x < width; ++x)
+			raw.insert(raw.end(), row + x * 4, row + x * 4 + 3);
+	}
+
+	std::vector<uint8_t> zlib;
+	zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	size_t offset = 0;
+	do {
+		const size_t block = std::min<size_t>(65535, raw.size() - offset);
+		zlib.push_back(offset + block == raw.size() ? 1 : 0);
+		zlib.push_back(static_cast<uint8_t>(block));
+		zlib.push_back(static_cast<uint8_t>(block >> 8));
+		zlib.push_back(static_cast<uint8_t>(~block));
+		zlib.push_back(static_cast<uint8_t>(~block >> 8));
+		zlib.insert(zlib.end(), raw.begin() + static_cast<std::ptrdiff_t>(offset), raw.begin() + static_cast<std::ptrdiff_t>(offset + block));
+		offset += block;
+	} while (offset < raw.size());
+
+	uint32_t a = 1, b = 0;
+	for (uint8_t byte : raw) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	put_u32_be(zlib, (b << 16) | a);
+
+	std::vector<uint8_t> header;
+	put_u32_be(header, width);
+	put_u32_be(header, height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });
+
+	out.clear();
+	out.insert(out.end(), { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' });
+	put_chunk("IHDR", header);
+	put_chunk("IDAT", zlib);
+	put_chunk("IEND", {});
+}
+
+inline void encode(ImageFormat format, const uint8_t* rgba, unsigned int width, unsigned int height, std::vector<uint8_t>& out) {
+	switch (format) {
+	case ImageFormat::PPM: encode_ppm(rgba, width, height, out); break;
+	case ImageFormat::PNG: encode_png(rgba, width, height, out); break;
+	case ImageFormat::QOI: encode_qoi(rgba, width, height, out); break;
+	}
+}
+
+inline bool write_file(const std::string& path, const std::vector<uint8_t>& bytes) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) return false;
+	file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	return static_cast<bool>(file);
+}
+
+inline bool write_image(const std::string& path, ImageFormat format, const uint8_t* rgba, unsigned int width, unsigned int height) {
+	std::vector<uint8_t> bytes;
+	encode(format, rgba, width, height, bytes);
+	return write_file(path, bytes);
+}
+
+}
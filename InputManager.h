@@ -1,7 +1,10 @@
 #pragma once
 #include <SFML/Window/Keyboard.hpp>
+#include "CameraController.h"
 #include "Enums.h"
 
+using Key = sf::Keyboard::Key;
+
 class InputManager {
 	bool key_f1_was_pressed_ = false;
 	bool key_f2_was_pressed_ = false;
@@ -9,7 +12,40 @@ class InputManager {
 	bool key_f4_was_pressed_ = false;
 
 public:
-	void update(ShadingMode& shading_mode, ProjectionMode& projection_mode) {
+	// Returns true when the camera moved or turned.
+	bool update_camera(CameraController& camera) const {
+		using sf::Keyboard::isKeyPressed;
+		const float moveSpeed = 0.1f;
+		const float rotateSpeed = 0.02f;
+		const Vector3<float> previous_position = camera.position;
+		const Vector3<float> previous_rotation = camera.rotation;
+
+		Vector3<float> forward, right, up;
+		camera.getBasis(forward, right, up);
+
+		if (isKeyPressed(Key::W)) camera.position = camera.position - forward * moveSpeed;
+		if (isKeyPressed(Key::S)) camera.position = camera.position + forward * moveSpeed;
+		if (isKeyPressed(Key::A)) camera.position = camera.position - right * moveSpeed;
+		if (isKeyPressed(Key::D)) camera.position = camera.position + right * moveSpeed;
+		if (isKeyPressed(Key::E)) camera.position = camera.position - up * moveSpeed;
+		if (isKeyPressed(Key::Q)) camera.position = camera.position + up * moveSpeed;
+
+		if (isKeyPressed(Key::Left))  camera.rotation.y += rotateSpeed;
+		if (isKeyPressed(Key::Right)) camera.rotation.y -= rotateSpeed;
+		if (isKeyPressed(Key::Up))    camera.rotation.x += rotateSpeed;
+		if (isKeyPressed(Key::Down))  camera.rotation.x -= rotateSpeed;
+
+		const Vector3<float>& p = camera.position;
+		const Vector3<float>& r = camera.rotation;
+		return p.x != previous_position.x || p.y != previous_position.y || p.z != previous_position.z ||
+			r.x != previous_rotation.x || r.y != previous_rotation.y;
+	}
+
+	// Returns true when either mode changed.
+	bool update(ShadingMode& shading_mode, ProjectionMode& projection_mode) {
+		const ShadingMode previous_shading = shading_mode;
+		const ProjectionMode previous_projection = projection_mode;
+
 		if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::F1)) {
 			if (!key_f1_was_pressed_) {
 				shading_mode = ShadingMode::FLAT;
@@ -43,5 +79,7 @@ public:
 			}
 		}
 		else key_f4_was_pressed_ = false;
+
+		return shading_mode != previous_shading || projection_mode != previous_projection;
 	}
 };
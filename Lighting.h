@@ -1,8 +1,9 @@
 #pragma once
 #include "Vector.h"
-#include <SFML/Graphics/Color.hpp>
+#include "Color.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 class Lighting {
 	Vector3<float> light_position_;
@@ -10,6 +11,7 @@ class Lighting {
 	float diffuse_;
 	float specular_;
 	float shininess_;
+	uint64_t revision_ = 0;
 
 public:
 	Lighting(
@@ -25,7 +27,32 @@ public:
 		shininess_(shininess) {
 	}
 
-	sf::Color calculate_color(const Vector3<float>& normal, const Vector3<float>& view_dir) const {
+	void set_light_position(const Vector3<float>& position) {
+		light_position_ = position;
+		++revision_;
+	}
+
+	const Vector3<float>& get_light_position() const { return light_position_; }
+
+	// Bumped on every change so cached shading results can be invalidated.
+	uint64_t revision() const { return revision_; }
+
+	// Smallest cosine between the reflected light and view directions at which the
+	// specular term still contributes about one 8-bit level. Below it, shading varies
+	// slowly enough to be shared between neighbouring pixels.
+	float highlight_cutoff() const {
+		const float threshold = 1.0f / 255.0f;
+		if (specular_ <= threshold) return 1.0f;
+		return std::pow(threshold / specular_, 1.0f / shininess_);
+	}
+
+	Vector3<float> reflect_light(const Vector3<float>& normal) const {
+		Vector3<float> N = normal.normalized();
+		Vector3<float> L = (light_position_).normalized();
+		return (N * (2.0f * N.dot(L)) - L).normalized();
+	}
+
+	Color calculate_color(const Vector3<float>& normal, const Vector3<float>& view_dir) const {
 		Vector3<float> N = normal.normalized();
 		Vector3<float> L = (light_position_).normalized();
 		Vector3<float> V = view_dir.normalized();
@@ -38,6 +65,7 @@ public:
 		intensity = std::clamp(intensity, 0.0f, 1.0f);
 
 		int color_value = static_cast<int>(intensity * 255);
-		return sf::Color(color_value, color_value, color_value);
+		const auto channel = static_cast<uint8_t>(color_value);
+		return Color(channel, channel, channel);
 	}
 };
@@ -39,6 +39,19 @@ struct Matrix4 {
         return {};
     }
 
+    bool operator==(const Matrix4& other) const {
+        for (int row = 0; row < 4; ++row) {
+            for (int col = 0; col < 4; ++col) {
+                if (m[row][col] != other.m[row][col]) return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const Matrix4& other) const {
+        return !(*this == other);
+    }
+
     Matrix4 operator*(const Matrix4& other) const {
         Matrix4 result = Matrix4::zero();
         for (int row = 0; row < 4; ++row) {
@@ -1,14 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include "Matrix.h"
+#include "QuantizedMesh.h"
 #include "Vector.h"
 
 class Mesh {
-
+public:
+    // Vertex normals as the average of the adjacent face normals; used when a file has none.
     void calculate_normals() {
         normals.resize(vertices.size(), Vector3(0.0f, 0.0f, 0.0f));
 
@@ -30,11 +35,67 @@ class Mesh {
             normal = normal.normalized();
         }
     }
-public:
+
     std::vector<Vector3<float>> vertices;
     std::vector<Vector3<int>> faces;
     std::vector<Vector3<float>> normals;
 
+    // Object-to-world placement, applied before the view/projection.
+    Matrix4 transform = Matrix4::identity();
+
+    // Object-space axis-aligned bounds, filled by load_from_obj / compute_bounds.
+    Vector3<float> bounds_min;
+    Vector3<float> bounds_max;
+
+    // Optional low-poly stand-in rasterized instead of this mesh when it acts as an occluder.
+    // It must lie inside the mesh so that it never hides something the mesh would not.
+    std::unique_ptr<Mesh> occluder;
+
+    // Compact copy drawn instead of the float arrays once quantize() has run.
+    std::unique_ptr<QuantizedMesh> quantized;
+
+    // With release_source the float arrays are freed; bounds stay valid, but the mesh
+    // then only occludes through an explicit occluder proxy.
+    void quantize(NormalEncoding encoding = NormalEncoding::OCT8, bool release_source = true) {
+        quantized = std::make_unique<QuantizedMesh>(QuantizedMesh::build(vertices, normals, faces, bounds_min, bounds_max, encoding));
+        if (release_source) {
+            std::vector<Vector3<float>>().swap(vertices);
+            std::vector<Vector3<float>>().swap(normals);
+            std::vector<Vector3<int>>().swap(faces);
+        }
+    }
+
+    size_t vertex_count() const {
+        return quantized ? quantized->vertex_count() : vertices.size();
+    }
+
+    size_t face_count() const {
+        return quantized ? quantized->triangle_count() : faces.size();
+    }
+
+    // Calls f(a, b, c) with the vertex indices of every face, from whichever storage is live.
+    template<typename F>
+    void for_each_face(F&& f) const {
+        if (quantized) {
+            quantized->for_each_face(f);
+            return;
+        }
+        for (const auto& face : faces)
+            f(static_cast<uint32_t>(face.x), static_cast<uint32_t>(face.y), static_cast<uint32_t>(face.z));
+    }
+
+    void compute_bounds() {
+        if (vertices.empty()) {
+            bounds_min = bounds_max = Vector3(0.0f, 0.0f, 0.0f);
+            return;
+        }
+        bounds_min = bounds_max = vertices.front();
+        for (const auto& v : vertices) {
+            bounds_min = Vector3(std::min(bounds_min.x, v.x), std::min(bounds_min.y, v.y), std::min(bounds_min.z, v.z));
+            bounds_max = Vector3(std::max(bounds_max.x, v.x), std::max(bounds_max.y, v.y), std::max(bounds_max.z, v.z));
+        }
+    }
+
     bool load_from_obj(const std::string& filename) {
         std::ifstream file(filename);
         if (!file.is_open()) {
@@ -91,14 +152,18 @@ public:
         {
             calculate_normals();
         }
+        compute_bounds();
         std::cout << "Loaded OBJ: " << filename << " | Vertices: "
             << vertices.size() << " | Faces: " << faces.size() << "\n";
 
         return true;
     }
 
-    [[nodiscard]] std::vector<Vector2<int>> get_edges() const {
-        std::vector<Vector2<int>> edges;
+    // Pass an ArenaAllocator to build the list in per-frame scratch memory.
+    template<typename Allocator = std::allocator<Vector2<int>>>
+    [[nodiscard]] std::vector<Vector2<int>, Allocator> get_edges(const Allocator& allocator = Allocator()) const {
+        std::vector<Vector2<int>, Allocator> edges(allocator);
+        edges.reserve(faces.size() * 3);
         for (const auto& face : faces) {
             int v1 = (face.x);
             int v2 = (face.y);
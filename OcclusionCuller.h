@@ -0,0 +1,242 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PC5_OCCLUSION_SSE 1
+#endif
+
+#include "FrameArena.h"
+#include "Matrix.h"
+#include "Mesh.h"
+
+// Coarse software occlusion culling. Occluder geometry is rasterized into a small
+// depth buffer (one cell per block of output pixels) that keeps a conservative farthest
+// depth per cell. Objects whose projected bounds are behind the stored depth in every
+// cell they touch are skipped before any vertex work.
+class OcclusionCuller {
+public:
+	struct Stats {
+		uint32_t occluders = 0;
+		uint32_t tested = 0;
+		uint32_t occluded = 0;
+	};
+
+private:
+	int width_ = 0;
+	int height_ = 0;
+	std::vector<float> depth_;
+	std::vector<uint16_t> mask_;
+	std::vector<float> pending_;
+	size_t max_occluder_faces_;
+	Stats stats_;
+
+	struct ScreenVertex {
+		float x, y, z;
+		bool in_front;
+		bool in_depth_range;
+	};
+
+	// Screen position in cells and depth in the renderer's [0, 1] convention.
+	ScreenVertex project(const Matrix4& mvp, const Vector3<float>& p) const {
+		Vector4<float> clip = mvp * Vector4<float>(p.x, p.y, p.z, 1.0f);
+		if (clip.w <= 1e-6f) return { 0.0f, 0.0f, 0.0f, false, false };
+		const float inv_w = 1.0f / clip.w;
+		const float z = clip.z * inv_w;
+		return {
+			(clip.x * inv_w + 1.0f) * 0.5f * static_cast<float>(width_),
+			(1.0f - (clip.y * inv_w + 1.0f) * 0.5f) * static_cast<float>(height_),
+			(z + 1.0f) * 0.5f,
+			true,
+			z >= -1.0f && z <= 1.0f
+		};
+	}
+
+	// Coverage within a cell is sampled on a kSamples x kSamples grid.
+	static constexpr int kSamples = 4;
+	static constexpr uint16_t kFullMask = 0xFFFF;
+
+	struct Edge { float a, b, c; };
+
+	// Bit (row * kSamples + column) set for each sample of the cell at (x, y) inside all three edges.
+	static uint16_t sample_mask(const Edge (&edges)[3], float x, float y) {
+		constexpr float step = 1.0f / kSamples;
+		uint16_t mask = 0;
+#ifdef PC5_OCCLUSION_SSE
+		const __m128 offsets = _mm_set_ps(3.5f * step, 2.5f * step, 1.5f * step, 0.5f * step);
+		const __m128 zero = _mm_setzero_ps();
+		__m128 steps[3];
+		for (int k = 0; k < 3; ++k)
+			steps[k] = _mm_mul_ps(offsets, _mm_set1_ps(edges[k].a));
+		for (int row = 0; row < kSamples; ++row) {
+			const float sy = y + (static_cast<float>(row) + 0.5f) * step;
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int k = 0; k < 3; ++k) {
+				const __m128 e = _mm_add_ps(_mm_set1_ps(edges[k].a * x + edges[k].b * sy + edges[k].c), steps[k]);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(e, zero));
+			}
+			mask |= static_cast<uint16_t>(_mm_movemask_ps(inside) << (row * kSamples));
+		}
+#else
+		for (int row = 0; row < kSamples; ++row) {
+			const float sy = y + (static_cast<float>(row) + 0.5f) * step;
+			for (int column = 0; column < kSamples; ++column) {
+				const float sx = x + (static_cast<float>(column) + 0.5f) * step;
+				bool inside = true;
+				for (const Edge& e : edges)
+					inside = inside && e.a * sx + e.b * sy + e.c >= 0.0f;
+				if (inside) mask |= static_cast<uint16_t>(1u << (row * kSamples + column));
+			}
+		}
+#endif
+		return mask;
+	}
+
+	// A cell's committed depth only moves once its samples are all covered, and then to the
+	// farthest depth among the triangles that covered it, so the buffer never claims more
+	// occlusion than the geometry provides at sample resolution.
+	void rasterize(const ScreenVertex& a, ScreenVertex b, ScreenVertex c) {
+		float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+		if (std::abs(area) < 1e-6f) return;
+		if (area < 0.0f) std::swap(b, c);
+
+		const float depth = std::max({ a.z, b.z, c.z });
+		const int xmin = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+		const int ymin = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+		const int xmax = std::min(width_ - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))) - 1);
+		const int ymax = std::min(height_ - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))) - 1);
+		if (xmin > xmax || ymin > ymax) return;
+
+		// Edge functions E(x, y) = A x + B y + C, positive inside. Over a cell [x, x+1] x [y, y+1]
+		// an edge ranges from E(x, y) + low to E(x, y) + high.
+		auto make_edge = [](const ScreenVertex& p, const ScreenVertex& q) {
+			return Edge{ p.y - q.y, q.x - p.x, p.x * q.y - p.y * q.x };
+		};
+		const Edge edges[3] = { make_edge(a, b), make_edge(b, c), make_edge(c, a) };
+		float low[3], high[3];
+		for (int k = 0; k < 3; ++k) {
+			low[k] = std::min(edges[k].a, 0.0f) + std::min(edges[k].b, 0.0f);
+			high[k] = std::max(edges[k].a, 0.0f) + std::max(edges[k].b, 0.0f);
+		}
+
+		for (int y = ymin; y <= ymax; ++y) {
+			const size_t row = static_cast<size_t>(y) * width_;
+			for (int x = xmin; x <= xmax; ++x) {
+				const size_t cell = row + x;
+				if (depth >= depth_[cell]) continue;
+
+				bool full = true, empty = false;
+				for (int k = 0; k < 3; ++k) {
+					const float e = edges[k].a * static_cast<float>(x) + edges[k].b * static_cast<float>(y) + edges[k].c;
+					full = full && e + low[k] >= 0.0f;
+					empty = empty || e + high[k] < 0.0f;
+				}
+				if (empty) continue;
+				if (full) {
+					depth_[cell] = depth;
+					continue;
+				}
+
+				const uint16_t mask = sample_mask(edges, static_cast<float>(x), static_cast<float>(y));
+				if (mask == 0) continue;
+				mask_[cell] |= mask;
+				pending_[cell] = std::max(pending_[cell], depth);
+				if (mask_[cell] == kFullMask) {
+					depth_[cell] = std::min(depth_[cell], pending_[cell]);
+					mask_[cell] = 0;
+					pending_[cell] = 0.0f;
+				}
+			}
+		}
+	}
+
+public:
+	// max_occluder_faces bounds how much geometry a mesh without an occluder proxy may
+	// contribute; larger meshes only occlude through Mesh::occluder.
+	explicit OcclusionCuller(size_t max_occluder_faces = 20000)
+		: max_occluder_faces_(max_occluder_faces) {
+	}
+
+	// Sizes the buffer for this frame (one cell per block of output pixels) and clears it.
+	void begin_frame(int output_width, int output_height, int cell_size = 8) {
+		width_ = std::max(1, output_width / cell_size);
+		height_ = std::max(1, output_height / cell_size);
+		const size_t cells = static_cast<size_t>(width_) * height_;
+		depth_.assign(cells, std::numeric_limits<float>::max());
+		mask_.assign(cells, 0);
+		pending_.assign(cells, 0.0f);
+		stats_ = Stats();
+	}
+
+	void add_occluder(const Mesh& mesh, const Matrix4& mvp, LinearArena& scratch) {
+		const Mesh* source = mesh.occluder ? mesh.occluder.get() : &mesh;
+		if (!mesh.occluder && mesh.faces.size() > max_occluder_faces_) return;
+		++stats_.occluders;
+
+		ScreenVertex* projected = scratch.allocate_array<ScreenVertex>(source->vertices.size());
+		for (size_t i = 0; i < source->vertices.size(); ++i)
+			projected[i] = project(mvp, source->vertices[i]);
+
+		for (const auto& face : source->faces) {
+			const ScreenVertex& a = projected[face.x];
+			const ScreenVertex& b = projected[face.y];
+			const ScreenVertex& c = projected[face.z];
+			if (a.in_depth_range && b.in_depth_range && c.in_depth_range)
+				rasterize(a, b, c);
+		}
+	}
+
+	// False only when the mesh's bounds are certainly hidden behind occluders.
+	bool is_visible(const Mesh& mesh, const Matrix4& mvp) {
+		++stats_.tested;
+		const Vector3<float>& lo = mesh.bounds_min;
+		const Vector3<float>& hi = mesh.bounds_max;
+
+		float min_x = std::numeric_limits<float>::max(), min_y = min_x, min_z = min_x;
+		float max_x = std::numeric_limits<float>::lowest(), max_y = max_x;
+		for (int corner = 0; corner < 8; ++corner) {
+			const Vector3<float> p((corner & 1) ? hi.x : lo.x, (corner & 2) ? hi.y : lo.y, (corner & 4) ? hi.z : lo.z);
+			const ScreenVertex v = project(mvp, p);
+			// Bounds reaching behind the eye can cover the whole view: treat as visible.
+			if (!v.in_front) return true;
+			min_x = std::min(min_x, v.x);
+			max_x = std::max(max_x, v.x);
+			min_y = std::min(min_y, v.y);
+			max_y = std::max(max_y, v.y);
+			min_z = std::min(min_z, v.z);
+		}
+
+		const int x0 = std::max(0, static_cast<int>(std::floor(min_x)));
+		const int y0 = std::max(0, static_cast<int>(std::floor(min_y)));
+		const int x1 = std::min(width_ - 1, static_cast<int>(std::floor(max_x)));
+		const int y1 = std::min(height_ - 1, static_cast<int>(std::floor(max_y)));
+		if (x0 > x1 || y0 > y1) return true;
+
+		for (int y = y0; y <= y1; ++y) {
+			const float* row = depth_.data() + static_cast<size_t>(y) * width_;
+			int x = x0;
+#ifdef PC5_OCCLUSION_SSE
+			const __m128 object_depth = _mm_set1_ps(min_z);
+			for (; x + 3 <= x1; x += 4) {
+				if (_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(row + x), object_depth)) != 0xF)
+					return true;
+			}
+#endif
+			for (; x <= x1; ++x) {
+				if (!(row[x] < min_z)) return true;
+			}
+		}
+
+		++stats_.occluded;
+		return false;
+	}
+
+	const Stats& stats() const { return stats_; }
+	int width() const { return width_; }
+	int height() const { return height_; }
+	const float* depth() const { return depth_.data(); }
+};
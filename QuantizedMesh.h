@@ -0,0 +1,318 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PC5_QUANTIZE_SSE 1
+#endif
+
+#include "Vector.h"
+
+enum class NormalEncoding {
+	OCT8,
+	OCT16
+};
+
+// Position quantized to 16 bits per axis across the mesh bounds. The normal lives in a
+// separate stream in the mesh's encoding, so a vertex costs 8 bytes with OCT8 and 10 with
+// OCT16, against 24 for the float position and normal.
+struct QuantizedVertex {
+	uint16_t position[3];
+};
+
+// Run of consecutive faces whose indices fit in 16 bits relative to vertex_base. Faces
+// that span more than 65536 vertices go to a wide meshlet with absolute 32-bit indices.
+struct Meshlet {
+	uint32_t vertex_base;
+	uint32_t first_index;
+	uint32_t triangle_count;
+	bool wide;
+};
+
+// Compact read-only copy of a mesh for the vertex stage. Decoding is exact inverse
+// arithmetic (origin + q * step), so the error is at most half a step per axis.
+class QuantizedMesh {
+public:
+	static constexpr uint32_t kMaxMeshletTriangles = 1024;
+
+	Vector3<float> origin;
+	Vector3<float> step;
+	NormalEncoding normal_encoding = NormalEncoding::OCT8;
+	std::vector<QuantizedVertex> vertices;
+	// One normal per vertex in exactly one of these, picked by normal_encoding: 2x8-bit
+	// octahedral for OCT8, 2x16-bit for OCT16. The other stays empty.
+	std::vector<uint16_t> compact_normals;
+	std::vector<uint32_t> fine_normals;
+	std::vector<Meshlet> meshlets;
+	std::vector<uint16_t> indices;
+	std::vector<uint32_t> wide_indices;
+
+	size_t vertex_count() const { return vertices.size(); }
+
+	size_t triangle_count() const {
+		size_t count = 0;
+		for (const auto& meshlet : meshlets)
+			count += meshlet.triangle_count;
+		return count;
+	}
+
+	size_t size_bytes() const {
+		return vertices.size() * sizeof(QuantizedVertex) + compact_normals.size() * sizeof(uint16_t) + fine_normals.size() * sizeof(uint32_t) +
+			meshlets.size() * sizeof(Meshlet) + indices.size() * sizeof(uint16_t) + wide_indices.size() * sizeof(uint32_t);
+	}
+
+	// Octahedral mapping of a direction onto [-1, 1]^2.
+	static void encode_octahedral(const Vector3<float>& n, float& u, float& v) {
+		const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		if (l1 <= 0.0f) {
+			u = v = 0.0f;
+			return;
+		}
+		u = n.x / l1;
+		v = n.y / l1;
+		if (n.z < 0.0f) {
+			const float fu = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			const float fv = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			u = fu;
+			v = fv;
+		}
+	}
+
+	// Inverse of encode_octahedral. The result is not unit length; the renderer
+	// normalizes after the view transform.
+	static Vector3<float> decode_octahedral(float u, float v) {
+		const float z = 1.0f - std::abs(u) - std::abs(v);
+		if (z < 0.0f) {
+			const float fu = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			const float fv = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			return Vector3<float>(fu, fv, z);
+		}
+		return Vector3<float>(u, v, z);
+	}
+
+	static QuantizedMesh build(const std::vector<Vector3<float>>& positions, const std::vector<Vector3<float>>& normals,
+		const std::vector<Vector3<int>>& faces, const Vector3<float>& bounds_min, const Vector3<float>& bounds_max,
+		NormalEncoding encoding = NormalEncoding::OCT8) {
+		QuantizedMesh mesh;
+		mesh.origin = bounds_min;
+		mesh.step = Vector3<float>(
+			std::max(bounds_max.x - bounds_min.x, 1e-20f) / 65535.0f,
+			std::max(bounds_max.y - bounds_min.y, 1e-20f) / 65535.0f,
+			std::max(bounds_max.z - bounds_min.z, 1e-20f) / 65535.0f);
+		mesh.normal_encoding = encoding;
+
+		auto quantize = [](float value, float origin, float step) {
+			return static_cast<uint16_t>(std::clamp(std::lround((value - origin) / step), 0l, 65535l));
+		};
+		auto snorm = [](float value, float range) {
+			return static_cast<uint32_t>(std::lround((std::clamp(value, -1.0f, 1.0f) * 0.5f + 0.5f) * range));
+		};
+
+		mesh.vertices.resize(positions.size());
+		if (encoding == NormalEncoding::OCT16)
+			mesh.fine_normals.resize(positions.size());
+		else
+			mesh.compact_normals.resize(positions.size());
+		for (size_t i = 0; i < positions.size(); ++i) {
+			QuantizedVertex& q = mesh.vertices[i];
+			q.position[0] = quantize(positions[i].x, mesh.origin.x, mesh.step.x);
+			q.position[1] = quantize(positions[i].y, mesh.origin.y, mesh.step.y);
+			q.position[2] = quantize(positions[i].z, mesh.origin.z, mesh.step.z);
+
+			float u = 0.0f, v = 0.0f;
+			if (i < normals.size())
+				encode_octahedral(normals[i], u, v);
+			if (encoding == NormalEncoding::OCT16)
+				mesh.fine_normals[i] = snorm(v, 65535.0f) << 16 | snorm(u, 65535.0f);
+			else
+				mesh.compact_normals[i] = static_cast<uint16_t>(snorm(v, 255.0f) << 8 | snorm(u, 255.0f));
+		}
+
+		// Greedy split of the face list into meshlets whose index range fits in 16 bits.
+		size_t first = 0;
+		while (first < faces.size()) {
+			int lo = std::min({ faces[first].x, faces[first].y, faces[first].z });
+			int hi = std::max({ faces[first].x, faces[first].y, faces[first].z });
+			size_t end = first + 1;
+			if (hi - lo <= 0xFFFF) {
+				while (end < faces.size() && end - first < kMaxMeshletTriangles) {
+					const int next_lo = std::min({ lo, faces[end].x, faces[end].y, faces[end].z });
+					const int next_hi = std::max({ hi, faces[end].x, faces[end].y, faces[end].z });
+					if (next_hi - next_lo > 0xFFFF) break;
+					lo = next_lo;
+					hi = next_hi;
+					++end;
+				}
+			}
+
+			Meshlet meshlet{ static_cast<uint32_t>(lo), 0, static_cast<uint32_t>(end - first), hi - lo > 0xFFFF };
+			if (meshlet.wide) {
+				meshlet.vertex_base = 0;
+				meshlet.first_index = static_cast<uint32_t>(mesh.wide_indices.size());
+				for (size_t f = first; f < end; ++f)
+					mesh.wide_indices.insert(mesh.wide_indices.end(), {
+						static_cast<uint32_t>(faces[f].x), static_cast<uint32_t>(faces[f].y), static_cast<uint32_t>(faces[f].z) });
+			}
+			else {
+				meshlet.first_index = static_cast<uint32_t>(mesh.indices.size());
+				for (size_t f = first; f < end; ++f)
+					mesh.indices.insert(mesh.indices.end(), {
+						static_cast<uint16_t>(faces[f].x - lo), static_cast<uint16_t>(faces[f].y - lo), static_cast<uint16_t>(faces[f].z - lo) });
+			}
+			mesh.meshlets.push_back(meshlet);
+			first = end;
+		}
+		return mesh;
+	}
+
+	// Decodes count vertices starting at first into float positions and normals.
+	void decode(size_t first, size_t count, Vector3<float>* positions, Vector3<float>* normals) const {
+		const QuantizedVertex* source = vertices.data() + first;
+		size_t i = 0;
+#ifdef PC5_QUANTIZE_SSE
+		// Four vertices per iteration: positions as one multiply-add per vertex, normals
+		// split into u/v lanes so the octahedral fold runs on four at once. The four
+		// 6-byte positions are 24 bytes, read as 16 + 8 and realigned to one per register.
+		const __m128 scale = _mm_set_ps(0.0f, step.z, step.y, step.x);
+		const __m128 offset = _mm_set_ps(0.0f, origin.z, origin.y, origin.x);
+		const __m128i zero = _mm_setzero_si128();
+		const bool fine = normal_encoding == NormalEncoding::OCT16;
+		const __m128 normal_scale = _mm_set1_ps(fine ? 2.0f / 65535.0f : 2.0f / 255.0f);
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 sign_bit = _mm_set1_ps(-0.0f);
+		for (; i + 4 <= count; i += 4) {
+			const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+			const __m128i tail = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(reinterpret_cast<const uint8_t*>(source + i) + 16));
+			const __m128i lanes[4] = {
+				_mm_unpacklo_epi16(head, zero),
+				_mm_unpacklo_epi16(_mm_srli_si128(head, 6), zero),
+				_mm_unpacklo_epi16(_mm_or_si128(_mm_srli_si128(head, 12), _mm_slli_si128(tail, 4)), zero),
+				_mm_unpacklo_epi16(_mm_srli_si128(tail, 2), zero)
+			};
+			alignas(16) float p[4][4];
+			for (int k = 0; k < 4; ++k)
+				_mm_store_ps(p[k], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(lanes[k]), scale), offset));
+			for (int k = 0; k < 4; ++k)
+				positions[i + k] = Vector3<float>(p[k][0], p[k][1], p[k][2]);
+
+			__m128i raw_u, raw_v;
+			if (fine) {
+				const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fine_normals.data() + first + i));
+				raw_u = _mm_and_si128(words, _mm_set1_epi32(0xFFFF));
+				raw_v = _mm_srli_epi32(words, 16);
+			}
+			else {
+				const __m128i words = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(compact_normals.data() + first + i)), zero);
+				raw_u = _mm_and_si128(words, _mm_set1_epi32(0xFF));
+				raw_v = _mm_srli_epi32(words, 8);
+			}
+			__m128 u = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(raw_u), normal_scale), one);
+			__m128 v = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(raw_v), normal_scale), one);
+			const __m128 abs_u = _mm_andnot_ps(sign_bit, u);
+			const __m128 abs_v = _mm_andnot_ps(sign_bit, v);
+			const __m128 z = _mm_sub_ps(_mm_sub_ps(one, abs_u), abs_v);
+			// Lower hemisphere: (u, v) = ((1 - |v|) sign(u), (1 - |u|) sign(v)).
+			const __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+			const __m128 folded_u = _mm_or_ps(_mm_sub_ps(one, abs_v), _mm_and_ps(u, sign_bit));
+			const __m128 folded_v = _mm_or_ps(_mm_sub_ps(one, abs_u), _mm_and_ps(v, sign_bit));
+			u = _mm_or_ps(_mm_and_ps(lower, folded_u), _mm_andnot_ps(lower, u));
+			v = _mm_or_ps(_mm_and_ps(lower, folded_v), _mm_andnot_ps(lower, v));
+			alignas(16) float nu[4], nv[4], nz[4];
+			_mm_store_ps(nu, u);
+			_mm_store_ps(nv, v);
+			_mm_store_ps(nz, z);
+			for (int k = 0; k < 4; ++k)
+				normals[i + k] = Vector3<float>(nu[k], nv[k], nz[k]);
+		}
+#endif
+		for (; i < count; ++i) {
+			const QuantizedVertex& q = source[i];
+			positions[i] = Vector3<float>(
+				static_cast<float>(q.position[0]) * step.x + origin.x,
+				static_cast<float>(q.position[1]) * step.y + origin.y,
+				static_cast<float>(q.position[2]) * step.z + origin.z);
+			float u, v;
+			if (normal_encoding == NormalEncoding::OCT16) {
+				const uint32_t word = fine_normals[first + i];
+				u = static_cast<float>(word & 0xFFFF) * (2.0f / 65535.0f) - 1.0f;
+				v = static_cast<float>(word >> 16) * (2.0f / 65535.0f) - 1.0f;
+			}
+			else {
+				const uint16_t word = compact_normals[first + i];
+				u = static_cast<float>(word & 0xFF) * (2.0f / 255.0f) - 1.0f;
+				v = static_cast<float>(word >> 8) * (2.0f / 255.0f) - 1.0f;
+			}
+			normals[i] = decode_octahedral(u, v);
+		}
+	}
+
+	// Flat byte image of the arrays, in host byte order, for chunk files.
+	void serialize(std::vector<uint8_t>& out) const {
+		auto put = [&out](const void* data, size_t bytes) {
+			const auto* p = static_cast<const uint8_t*>(data);
+			out.insert(out.end(), p, p + bytes);
+		};
+		auto put_array = [&](const auto& array) {
+			const uint64_t count = array.size();
+			put(&count, sizeof(count));
+			put(array.data(), array.size() * sizeof(array[0]));
+		};
+		const float header[6] = { origin.x, origin.y, origin.z, step.x, step.y, step.z };
+		const uint32_t encoding = static_cast<uint32_t>(normal_encoding);
+		put(header, sizeof(header));
+		put(&encoding, sizeof(encoding));
+		put_array(vertices);
+		put_array(compact_normals);
+		put_array(fine_normals);
+		put_array(meshlets);
+		put_array(indices);
+		put_array(wide_indices);
+	}
+
+	// Inverse of serialize; false if the bytes run out.
+	bool deserialize(const uint8_t* data, size_t size) {
+		size_t offset = 0;
+		auto get = [&](void* target, size_t bytes) {
+			if (offset + bytes > size) return false;
+			std::memcpy(target, data + offset, bytes);
+			offset += bytes;
+			return true;
+		};
+		auto get_array = [&](auto& array) {
+			uint64_t count = 0;
+			if (!get(&count, sizeof(count)) || count > (size - offset) / sizeof(array[0])) return false;
+			array.resize(static_cast<size_t>(count));
+			return get(array.data(), array.size() * sizeof(array[0]));
+		};
+		float header[6];
+		uint32_t encoding = 0;
+		if (!get(header, sizeof(header)) || !get(&encoding, sizeof(encoding))) return false;
+		origin = Vector3<float>(header[0], header[1], header[2]);
+		step = Vector3<float>(header[3], header[4], header[5]);
+		normal_encoding = static_cast<NormalEncoding>(encoding);
+		return get_array(vertices) && get_array(compact_normals) && get_array(fine_normals) && get_array(meshlets) &&
+			get_array(indices) && get_array(wide_indices);
+	}
+
+	// Calls f(a, b, c) with absolute vertex indices for every face, in the original order.
+	template<typename F>
+	void for_each_face(F&& f) const {
+		for (const auto& meshlet : meshlets) {
+			if (meshlet.wide) {
+				const uint32_t* index = wide_indices.data() + meshlet.first_index;
+				for (uint32_t t = 0; t < meshlet.triangle_count; ++t, index += 3)
+					f(index[0], index[1], index[2]);
+			}
+			else {
+				const uint16_t* index = indices.data() + meshlet.first_index;
+				const uint32_t base = meshlet.vertex_base;
+				for (uint32_t t = 0; t < meshlet.triangle_count; ++t, index += 3)
+					f(base + index[0], base + index[1], base + index[2]);
+			}
+		}
+	}
+};
@@ -0,0 +1,166 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameArena.h"
+
+// Maps a float to a key whose unsigned order matches the float order.
+inline uint32_t float_sort_key(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+// Stable LSD radix sort of 32-bit keys carrying 32-bit values, one byte per pass.
+// Passes whose byte is the same for every key are skipped, so keys that share their high
+// bits (depths in a narrow range) cost fewer passes. Large inputs are split into one
+// chunk per thread: each thread histograms its chunk, and after a shared prefix sum
+// scatters it to disjoint output ranges, which keeps the sort stable.
+class RadixSorter {
+	static constexpr int kRadix = 256;
+
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable start_cv_;
+	std::condition_variable done_cv_;
+	const std::function<void(unsigned int)>* task_ = nullptr;
+	uint64_t generation_ = 0;
+	unsigned int pending_ = 0;
+	bool stopping_ = false;
+	size_t parallel_threshold_;
+
+	void worker_loop(unsigned int index) {
+		uint64_t seen = 0;
+		while (true) {
+			const std::function<void(unsigned int)>* task;
+			{
+				std::unique_lock lock(mutex_);
+				start_cv_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+				if (stopping_) return;
+				seen = generation_;
+				task = task_;
+			}
+			(*task)(index);
+			{
+				std::lock_guard lock(mutex_);
+				if (--pending_ == 0) done_cv_.notify_one();
+			}
+		}
+	}
+
+	// Runs task(0) on the calling thread and task(1..n) on the workers, then waits for all.
+	void run(const std::function<void(unsigned int)>& task) {
+		{
+			std::lock_guard lock(mutex_);
+			task_ = &task;
+			pending_ = static_cast<unsigned int>(workers_.size());
+			++generation_;
+		}
+		start_cv_.notify_all();
+		task(0);
+		std::unique_lock lock(mutex_);
+		done_cv_.wait(lock, [this] { return pending_ == 0; });
+	}
+
+public:
+	// threads counts the calling thread; 0 picks one per hardware thread, up to 8.
+	// Inputs smaller than parallel_threshold are sorted on the calling thread only.
+	explicit RadixSorter(unsigned int threads = 0, size_t parallel_threshold = 32 * 1024)
+		: parallel_threshold_(parallel_threshold) {
+		if (threads == 0)
+			threads = std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+		for (unsigned int i = 1; i < threads; ++i)
+			workers_.emplace_back(&RadixSorter::worker_loop, this, i);
+	}
+
+	~RadixSorter() {
+		{
+			std::lock_guard lock(mutex_);
+			stopping_ = true;
+		}
+		start_cv_.notify_all();
+		for (auto& worker : workers_)
+			worker.join();
+	}
+
+	RadixSorter(const RadixSorter&) = delete;
+	RadixSorter& operator=(const RadixSorter&) = delete;
+
+	unsigned int thread_count() const { return static_cast<unsigned int>(workers_.size()) + 1; }
+
+	// Sorts keys ascending and applies the same permutation to values. Temporary buffers
+	// come from scratch.
+	void sort(uint32_t* keys, uint32_t* values, size_t count, LinearArena& scratch) {
+		if (count < 2) return;
+		const unsigned int parts = count >= parallel_threshold_ ? thread_count() : 1;
+		const size_t chunk = (count + parts - 1) / parts;
+
+		uint32_t* key_buffer = scratch.allocate_array<uint32_t>(count);
+		uint32_t* value_buffer = scratch.allocate_array<uint32_t>(count);
+		size_t* histograms = scratch.allocate_array<size_t>(static_cast<size_t>(parts) * kRadix);
+
+		uint32_t* source_keys = keys;
+		uint32_t* source_values = values;
+		uint32_t* target_keys = key_buffer;
+		uint32_t* target_values = value_buffer;
+
+		for (int shift = 0; shift < 32; shift += 8) {
+			auto histogram = [&](unsigned int part) {
+				size_t* counts = histograms + static_cast<size_t>(part) * kRadix;
+				std::fill(counts, counts + kRadix, size_t(0));
+				const size_t end = std::min(count, (part + 1) * chunk);
+				for (size_t i = part * chunk; i < end; ++i)
+					++counts[(source_keys[i] >> shift) & 0xFF];
+			};
+			auto scatter = [&](unsigned int part) {
+				size_t* offsets = histograms + static_cast<size_t>(part) * kRadix;
+				const size_t end = std::min(count, (part + 1) * chunk);
+				for (size_t i = part * chunk; i < end; ++i) {
+					const size_t slot = offsets[(source_keys[i] >> shift) & 0xFF]++;
+					target_keys[slot] = source_keys[i];
+					target_values[slot] = source_values[i];
+				}
+			};
+
+			if (parts > 1)
+				run([&](unsigned int part) { if (part < parts) histogram(part); });
+			else
+				histogram(0);
+
+			// Exclusive prefix over (digit, part) turns the counts into write offsets.
+			size_t total = 0;
+			bool trivial = false;
+			for (int digit = 0; digit < kRadix; ++digit) {
+				size_t digit_total = 0;
+				for (unsigned int part = 0; part < parts; ++part) {
+					size_t& slot = histograms[static_cast<size_t>(part) * kRadix + digit];
+					const size_t n = slot;
+					slot = total + digit_total;
+					digit_total += n;
+				}
+				if (digit_total == count) trivial = true;
+				total += digit_total;
+			}
+			if (trivial) continue;
+
+			if (parts > 1)
+				run([&](unsigned int part) { if (part < parts) scatter(part); });
+			else
+				scatter(0);
+
+			std::swap(source_keys, target_keys);
+			std::swap(source_values, target_values);
+		}
+
+		if (source_keys != keys) {
+			std::memcpy(keys, source_keys, count * sizeof(uint32_t));
+			std::memcpy(values, source_values, count * sizeof(uint32_t));
+		}
+	}
+};
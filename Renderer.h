@@ -1,93 +1,264 @@
 #pragma once
+#include "FrameArena.h"
+#include "Color.h"
 #include "Framebuffer.h"
 #include "Lighting.h"
 #include "CameraController.h"
+#include "DepthBuffer.h"
 #include "Enums.h"
 #include "Mesh.h"
 #include "Matrix.h"
+#include "RadixSort.h"
 #include "Vector.h"
 #include <vector>
 #include <optional>
-#include <SFML/Graphics/Color.hpp>
 #include <cmath>
 #include <limits>
 #include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PC5_RASTER_SSE 1
+#endif
 
 struct Vertex {
 	Vector2<int> position;
 	float z;
 	Vector3<float> normal;
-	sf::Color color;
+	Color color;
 };
 
 class Renderer {
+public:
+	struct FrameStats {
+		uint64_t pixels_written = 0;
+		uint64_t shading_evaluations = 0;
+		uint64_t micro_triangles = 0;
+		uint64_t dropped_triangles = 0;
+		uint64_t vertices_transformed = 0;	// vertex stage runs; cache hits add nothing
+	};
+
+private:
+	// Post-transform vertices of one mesh, reused while the inputs that produced them are unchanged.
+	struct TransformCache {
+		Matrix4 mvp;
+		Matrix4 view;
+		Vector3<float> eye;
+		int width = 0;
+		int height = 0;
+		uint64_t lighting_revision = 0;
+		bool valid = false;
+		std::vector<std::optional<Vertex>> vertices;
+	};
+
 	int width_;
 	int height_;
 	Framebuffer* framebuffer_;
-	float* depth_buffer_;
+	DepthBuffer* depth_buffer_;
 	Lighting* lighting_;
 	ShadingMode shading_mode_;
+	FrameArena* frame_arena_ = nullptr;
+	bool coarse_shading_ = false;
+	float coarse_shading_cos_ = 0.0f;
+	DrawOrder draw_order_ = DrawOrder::SUBMISSION;
+	std::unique_ptr<RadixSorter> sorter_;
+	std::unique_ptr<LinearArena> sort_scratch_;
+	FrameStats stats_;
+	std::unordered_map<const Mesh*, TransformCache> transform_cache_;
+
+	// Triangles whose bounding box spans at most kMicroSpan + 1 pixels per axis have their
+	// sample coverage computed kMicroBatch at a time, one triangle per SIMD lane.
+	static constexpr int kMicroSpan = 3;
+	static constexpr int kMicroBatch = 4;
+
+	struct MicroTriangle {
+		const Vertex* v[3];
+		int xmin, ymin;
+		int area;
+	};
+
+	bool micro_triangles_ = true;
+	MicroTriangle micro_batch_[kMicroBatch];
+	int micro_count_ = 0;
+
+	std::optional<Vertex> project_vertex(const Vector3<float>& vertex, const Vector3<float>& n, const Matrix4& mvp, const Matrix4& view, const CameraController& camera) const {
+		Vector4 v(vertex.x, vertex.y, vertex.z, 1.0f);
+		Vector4 projected = mvp * v;
+
+		if (projected.w != 0.0f) {
+			projected.x /= projected.w;
+			projected.y /= projected.w;
+			projected.z /= projected.w;
+		}
+
+		if (projected.x < -1 || projected.x > 1 || projected.y < -1 || projected.y > 1 || projected.z < -1 || projected.z > 1)
+			return std::nullopt;
+
+		Vector4 n4(n.x, n.y, n.z, 0.0f);
+		Vector4 n_transformed = view * n4;
+
+		Vector3<float> normal_transformed = Vector3(
+			n_transformed.x,
+			n_transformed.y,
+			n_transformed.z).normalized();
+
+		float depth = (projected.z + 1.0f) * 0.5f;
+		int screen_x = static_cast<int>((projected.x + 1.0f) * 0.5f * static_cast<float>(width_));
+		int screen_y = static_cast<int>((1.0f - (projected.y + 1.0f) * 0.5f) * static_cast<float>(height_));
+
+		Color vertex_color = lighting_->calculate_color(normal_transformed, camera.position);
+
+		return Vertex{ Vector2(screen_x, screen_y), depth, normal_transformed, vertex_color };
+	}
+
+	// Decodes a compact mesh a chunk at a time, so the float copy stays in cache, and hands
+	// each projected vertex to emit in order.
+	template<typename Emit>
+	void project_quantized(const Mesh& mesh, const Matrix4& mvp, const Matrix4& view, const CameraController& camera, Emit&& emit) const {
+		constexpr size_t kChunk = 256;
+		Vector3<float> positions[kChunk];
+		Vector3<float> normals[kChunk];
+		const size_t count = mesh.quantized->vertex_count();
+		for (size_t first = 0; first < count; first += kChunk) {
+			const size_t n = std::min(kChunk, count - first);
+			mesh.quantized->decode(first, n, positions, normals);
+			for (size_t i = 0; i < n; ++i)
+				emit(project_vertex(positions[i], normals[i], mvp, view, camera));
+		}
+	}
+
+	// Projected vertices of the mesh, indexed by vertex. Float meshes are cached across
+	// frames. Compact meshes are projected into frame-arena scratch instead, so they never
+	// hold a persistent 32-byte-per-vertex copy; without an arena they use the cache too.
+	const std::optional<Vertex>* transform_vertices(const Mesh& mesh, const Matrix4& mvp, const Matrix4& view, const CameraController& camera) {
+		if (mesh.quantized && frame_arena_) {
+			auto* projected = frame_arena_->main().allocate_array<std::optional<Vertex>>(mesh.quantized->vertex_count());
+			size_t next = 0;
+			project_quantized(mesh, mvp, view, camera, [&](std::optional<Vertex> vertex) { new (projected + next++) std::optional<Vertex>(vertex); });
+			stats_.vertices_transformed += next;
+			return projected;
+		}
+
+		TransformCache& cache = transform_cache_[&mesh];
+		const Vector3<float>& eye = camera.position;
+		if (cache.valid && cache.mvp == mvp && cache.view == view &&
+			cache.eye.x == eye.x && cache.eye.y == eye.y && cache.eye.z == eye.z &&
+			cache.width == width_ && cache.height == height_ &&
+			cache.lighting_revision == lighting_->revision() &&
+			cache.vertices.size() == mesh.vertex_count()) {
+			return cache.vertices.data();
+		}
+
+		cache.mvp = mvp;
+		cache.view = view;
+		cache.eye = eye;
+		cache.width = width_;
+		cache.height = height_;
+		cache.lighting_revision = lighting_->revision();
+		cache.valid = true;
+
+		auto& projected_vertices = cache.vertices;
+		projected_vertices.clear();
+		projected_vertices.reserve(mesh.vertex_count());
+		if (!mesh.quantized) {
+			for (size_t i = 0; i < mesh.vertices.size(); ++i)
+				projected_vertices.push_back(project_vertex(mesh.vertices[i], mesh.normals[i], mvp, view, camera));
+		}
+		else {
+			project_quantized(mesh, mvp, view, camera, [&](std::optional<Vertex> vertex) { projected_vertices.push_back(vertex); });
+		}
+		stats_.vertices_transformed += projected_vertices.size();
+		return projected_vertices.data();
+	}
 
 public:
-	Renderer(int width, int height, Framebuffer* framebuffer, float* depth_buffer, Lighting* lighting, ShadingMode mode)
+	Renderer(int width, int height, Framebuffer* framebuffer, DepthBuffer* depth_buffer, Lighting* lighting, ShadingMode mode)
 		: width_(width), height_(height), framebuffer_(framebuffer), depth_buffer_(depth_buffer),
 		lighting_(lighting), shading_mode_(mode) {
 	}
 
 	void set_shading_mode(ShadingMode mode) { shading_mode_ = mode; }
 
-	void clear_depth() {
-		for (int i = 0; i < width_ * height_; ++i)
-			depth_buffer_[i] = std::numeric_limits<float>::max();
+	// Redirects rendering to another color/depth pair, e.g. a lower-resolution target.
+	void set_target(int width, int height, Framebuffer* framebuffer, DepthBuffer* depth_buffer) {
+		width_ = width;
+		height_ = height;
+		framebuffer_ = framebuffer;
+		depth_buffer_ = depth_buffer;
 	}
 
-	void draw_mesh(const Mesh& mesh, const Matrix4& mvp, const Matrix4& view, const CameraController& camera) {
-		std::vector<std::optional<Vertex>> projected_vertices;
-		for (size_t i = 0; i < mesh.vertices.size(); ++i) {
-			const auto& vertex = mesh.vertices[i];
-			Vector4 v(vertex.x, vertex.y, vertex.z, 1.0f);
-			Vector4 projected = mvp * v;
-
-			if (projected.w != 0.0f) {
-				projected.x /= projected.w;
-				projected.y /= projected.w;
-				projected.z /= projected.w;
-			}
+	// Scratch memory for per-frame pipeline data; owned by the caller and reset once per frame.
+	void set_frame_arena(FrameArena* arena) { frame_arena_ = arena; }
+	FrameArena* frame_arena() const { return frame_arena_; }
 
-			if (projected.x < -1 || projected.x > 1 || projected.y < -1 || projected.y > 1 || projected.z < -1 || projected.z > 1) {
-				projected_vertices.emplace_back(std::nullopt);
-				continue;
-			}
+	// Drops cached vertices for a mesh about to be freed, so a new mesh allocated at the
+	// same address cannot pick them up.
+	void forget_mesh(const Mesh* mesh) { transform_cache_.erase(mesh); }
 
-			Vector3<float> n = mesh.normals[i];
-			Vector4 n4(n.x, n.y, n.z, 0.0f);
-			Vector4 n_transformed = view * n4;
+	// Memory held by cached post-transform vertices across all meshes.
+	size_t transform_cache_bytes() const {
+		size_t bytes = 0;
+		for (const auto& entry : transform_cache_)
+			bytes += entry.second.vertices.capacity() * sizeof(std::optional<Vertex>);
+		return bytes;
+	}
 
-			Vector3<float> normal_transformed = Vector3(
-				n_transformed.x,
-				n_transformed.y,
-				n_transformed.z).normalized();
+	// Adaptive shading rate for PHONG: blocks where the interpolated normal varies by less
+	// than max_angle_degrees, away from specular highlights, share one shading evaluation.
+	void set_coarse_shading(bool enabled, float max_angle_degrees = 2.0f) {
+		coarse_shading_ = enabled;
+		coarse_shading_cos_ = std::cos(max_angle_degrees * 3.1415f / 180.0f);
+	}
+	bool coarse_shading() const { return coarse_shading_; }
 
-			float depth = (projected.z + 1.0f) * 0.5f;
-			int screen_x = static_cast<int>((projected.x + 1.0f) * 0.5f * static_cast<float>(width_));
-			int screen_y = static_cast<int>((1.0f - (projected.y + 1.0f) * 0.5f) * static_cast<float>(height_));
+	// FRONT_TO_BACK submits each mesh's triangles nearest first, so later triangles mostly
+	// fail the depth test before shading. The order within equal depths is unchanged.
+	void set_draw_order(DrawOrder order) {
+		draw_order_ = order;
+		if (order == DrawOrder::FRONT_TO_BACK && !sorter_)
+			sorter_ = std::make_unique<RadixSorter>();
+	}
+	DrawOrder draw_order() const { return draw_order_; }
 
-			sf::Color vertex_color = lighting_->calculate_color(normal_transformed, camera.position);
+	// Batched coverage for triangles a few pixels across; output is identical either way.
+	void set_micro_triangles(bool enabled) { micro_triangles_ = enabled; }
+	bool micro_triangles() const { return micro_triangles_; }
 
-			projected_vertices.emplace_back(Vertex{ Vector2(screen_x, screen_y), depth, normal_transformed, vertex_color });
+	const FrameStats& stats() const { return stats_; }
+	void reset_stats() { stats_ = FrameStats(); }
+
+	// Pixel writes per covered pixel since the last reset_stats(); 1 means no overdraw.
+	float overdraw_ratio() const {
+		const size_t covered = depth_buffer_->covered_pixels();
+		return covered ? static_cast<float>(stats_.pixels_written) / static_cast<float>(covered) : 0.0f;
+	}
+
+	void clear_depth() { depth_buffer_->clear(); }
+	const DepthBuffer* depth_buffer() const { return depth_buffer_; }
+
+	void draw_mesh(const Mesh& mesh, const Matrix4& mvp, const Matrix4& view, const CameraController& camera) {
+		// The vertex stage output (positions, normals, Gouraud colors) does not depend on the
+		// shading mode, so frames that only switch modes skip straight to rasterization.
+		const std::optional<Vertex>* projected_vertices = transform_vertices(mesh, mvp, view, camera);
+
+		if (draw_order_ == DrawOrder::FRONT_TO_BACK) {
+			draw_sorted(mesh, projected_vertices, camera);
+			return;
 		}
 
-		for (const auto& face : mesh.faces) {
-			int v1 = face.x;
-			int v2 = face.y;
-			int v3 = face.z;
+		mesh.for_each_face([&](uint32_t v1, uint32_t v2, uint32_t v3) {
 			if (projected_vertices[v1] && projected_vertices[v2] && projected_vertices[v3]) {
 				const auto& vtx1 = projected_vertices[v3].value();
 				const auto& vtx2 = projected_vertices[v2].value();
 				const auto& vtx3 = projected_vertices[v1].value();
-				draw_triangle(vtx1, vtx2, vtx3, camera);
+				submit_triangle(vtx1, vtx2, vtx3, camera);
 			}
-		}
+		});
+		flush_micro_triangles(camera);
 	}
 
 	void draw_triangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const CameraController& camera) {
@@ -105,14 +276,18 @@ public:
 
 		float area = getDeterminant(a, b, c);
 		if (std::abs(area) < 1e-6f) return;
+		const DepthPlane plane{ a, b, c, area, za, zb, zc };
+		depth_buffer_->begin_triangle(plane);
 
-		sf::Color face_color = sf::Color::White;
-		if (shading_mode_ == ShadingMode::FLAT) {
-			Vector3<float> face_normal = (v1.normal + v2.normal + v0.normal).normalized();
-			face_color = lighting_->calculate_color(face_normal, camera.position);
+		if (shading_mode_ == ShadingMode::PHONG && coarse_shading_) {
+			draw_triangle_coarse_phong(v0, v1, v2, camera, xmin, ymin, xmax, ymax, area);
+			return;
 		}
 
-		auto randomColor = sf::Color(rand() % 256, rand() % 256, rand() % 256);
+		bool has_face_color = false;
+		Color face_color = Color::White;
+
+		auto randomColor = Color(static_cast<uint8_t>(rand() % 256), static_cast<uint8_t>(rand() % 256), static_cast<uint8_t>(rand() % 256));
 		for (int y = ymin; y <= ymax; ++y) {
 			for (int x = xmin; x <= xmax; ++x) {
 				if (x < 0 || x >= width_ || y < 0 || y >= height_) continue;
@@ -125,41 +300,323 @@ public:
 					float alpha = w0 / area;
 					float beta = w1 / area;
 					float gamma = w2 / area;
-					float z = 1.0f / (alpha / za + beta / zb + gamma / zc);
+					float z = plane.depth(alpha, beta, gamma);
+
+					if (depth_buffer_->test_and_set(x, y, z)) {
+						Color color = shade(v0, v1, v2, alpha, beta, gamma, camera, has_face_color, face_color);
+						framebuffer_->set_pixel(x, y, color);
+						++stats_.pixels_written;
+					}
+				}
+			}
+		}
+	}
 
-					if (z < depth_buffer_[y * width_ + x]) {
-						sf::Color color;
+private:
+	// Routes a triangle by screen size. Vertices are snapped to pixel positions, which are
+	// also the sample positions, so a triangle with non-positive area covers no sample and
+	// is dropped before any setup. Small ones are batched; anything larger first draws the
+	// pending batch so triangles still land in submission order.
+	void submit_triangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, const CameraController& camera) {
+		const Vector2<int>& a = v0.position;
+		const Vector2<int>& b = v1.position;
+		const Vector2<int>& c = v2.position;
+		const int area = (a.x - c.x) * (b.y - c.y) - (b.x - c.x) * (a.y - c.y);
+		if (area <= 0) {
+			++stats_.dropped_triangles;
+			return;
+		}
 
-						if (shading_mode_ == ShadingMode::FLAT) {
-							color = face_color;
-						}
-						else if (shading_mode_ == ShadingMode::GOURAUD) {
-							auto interp = [&](uint8_t ca, uint8_t cb, uint8_t cc) -> uint8_t {
-								return static_cast<uint8_t>(
-									alpha * static_cast<float>(ca) +
-									beta * static_cast<float>(cb) +
-									gamma * static_cast<float>(cc));
-								};
-							color = sf::Color(
-								interp(v0.color.r, v1.color.r, v2.color.r),
-								interp(v0.color.g, v1.color.g, v2.color.g),
-								interp(v0.color.b, v1.color.b, v2.color.b));
-						}
-						else if (shading_mode_ == ShadingMode::PHONG) {
-							Vector3<float> interpolated_normal =
-								(v0.normal * alpha + v1.normal * beta + v2.normal * gamma).normalized();
-							color = lighting_->calculate_color(interpolated_normal, camera.position);
+		const int xmin = std::min({ a.x, b.x, c.x });
+		const int ymin = std::min({ a.y, b.y, c.y });
+		if (!micro_triangles_ || std::max({ a.x, b.x, c.x }) - xmin > kMicroSpan || std::max({ a.y, b.y, c.y }) - ymin > kMicroSpan) {
+			flush_micro_triangles(camera);
+			draw_triangle(v0, v1, v2, camera);
+			return;
+		}
+
+		micro_batch_[micro_count_++] = { { &v0, &v1, &v2 }, xmin, ymin, area };
+		if (micro_count_ == kMicroBatch)
+			flush_micro_triangles(camera);
+	}
+
+	// Coverage of the (kMicroSpan + 1)^2 samples from each triangle's bounding box corner,
+	// bit j * 4 + i for sample (xmin + i, ymin + j). Edge functions have integer
+	// coefficients here, so stepping them with integer adds is exact.
+	void micro_coverage(uint16_t* masks) const {
+		static_assert(kMicroSpan == 3 && kMicroBatch == 4, "coverage masks assume 4x4 samples and 4 lanes");
+		int start[3][kMicroBatch], step_x[3][kMicroBatch], step_y[3][kMicroBatch];
+		for (int t = 0; t < kMicroBatch; ++t) {
+			// Unused lanes get an edge that is negative everywhere.
+			if (t >= micro_count_) {
+				for (int k = 0; k < 3; ++k) { start[k][t] = -1; step_x[k][t] = 0; step_y[k][t] = 0; }
+				continue;
+			}
+			const MicroTriangle& tri = micro_batch_[t];
+			// w_k(p) = det(q, r, p) for edges (b, c), (c, a), (a, b), as in draw_triangle.
+			for (int k = 0; k < 3; ++k) {
+				const Vector2<int>& q = tri.v[(k + 1) % 3]->position;
+				const Vector2<int>& r = tri.v[(k + 2) % 3]->position;
+				step_x[k][t] = q.y - r.y;
+				step_y[k][t] = r.x - q.x;
+				start[k][t] = q.x * r.y - r.x * q.y + step_x[k][t] * tri.xmin + step_y[k][t] * tri.ymin;
+			}
+		}
+
+		for (int t = 0; t < kMicroBatch; ++t) masks[t] = 0;
+#ifdef PC5_RASTER_SSE
+		__m128i row[3], dx[3], dy[3];
+		for (int k = 0; k < 3; ++k) {
+			row[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(start[k]));
+			dx[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(step_x[k]));
+			dy[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(step_y[k]));
+		}
+		const __m128i negative = _mm_set1_epi32(-1);
+		for (int j = 0; j <= kMicroSpan; ++j) {
+			__m128i w[3] = { row[0], row[1], row[2] };
+			for (int i = 0; i <= kMicroSpan; ++i) {
+				const __m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(w[0], negative), _mm_cmpgt_epi32(w[1], negative)), _mm_cmpgt_epi32(w[2], negative));
+				const int lanes = _mm_movemask_ps(_mm_castsi128_ps(inside));
+				for (int t = 0; t < kMicroBatch; ++t)
+					masks[t] |= static_cast<uint16_t>(((lanes >> t) & 1) << (j * 4 + i));
+				for (int k = 0; k < 3; ++k) w[k] = _mm_add_epi32(w[k], dx[k]);
+			}
+			for (int k = 0; k < 3; ++k) row[k] = _mm_add_epi32(row[k], dy[k]);
+		}
+#else
+		for (int t = 0; t < micro_count_; ++t) {
+			for (int j = 0; j <= kMicroSpan; ++j) {
+				for (int i = 0; i <= kMicroSpan; ++i) {
+					bool inside = true;
+					for (int k = 0; k < 3; ++k)
+						inside = inside && start[k][t] + step_x[k][t] * i + step_y[k][t] * j >= 0;
+					if (inside) masks[t] |= static_cast<uint16_t>(1u << (j * 4 + i));
+				}
+			}
+		}
+#endif
+	}
+
+	// Shades the batch in submission order with the same per-sample math as draw_triangle.
+	void flush_micro_triangles(const CameraController& camera) {
+		if (micro_count_ == 0) return;
+		uint16_t masks[kMicroBatch];
+		micro_coverage(masks);
+
+		for (int t = 0; t < micro_count_; ++t) {
+			const MicroTriangle& tri = micro_batch_[t];
+			const Vertex& v0 = *tri.v[0];
+			const Vertex& v1 = *tri.v[1];
+			const Vertex& v2 = *tri.v[2];
+			const Vector2<float> a = v0.position;
+			const Vector2<float> b = v1.position;
+			const Vector2<float> c = v2.position;
+			const float area = static_cast<float>(tri.area);
+			const DepthPlane plane{ a, b, c, area, v0.z, v1.z, v2.z };
+			depth_buffer_->begin_triangle(plane);
+			++stats_.micro_triangles;
+
+			bool has_face_color = false;
+			Color face_color = Color::White;
+			for (int bit = 0; bit < 16; ++bit) {
+				if (!(masks[t] & (1u << bit))) continue;
+				const int x = tri.xmin + (bit & 3);
+				const int y = tri.ymin + (bit >> 2);
+				if (x < 0 || x >= width_ || y < 0 || y >= height_) continue;
+				Vector2<float> p(static_cast<float>(x), static_cast<float>(y));
+
+				float alpha = getDeterminant(b, c, p) / area;
+				float beta = getDeterminant(c, a, p) / area;
+				float gamma = getDeterminant(a, b, p) / area;
+				if (!depth_buffer_->test_and_set(x, y, plane.depth(alpha, beta, gamma))) continue;
+
+				framebuffer_->set_pixel(x, y, shade(v0, v1, v2, alpha, beta, gamma, camera, has_face_color, face_color));
+				++stats_.pixels_written;
+			}
+		}
+		micro_count_ = 0;
+	}
+
+	Color shade(const Vertex& v0, const Vertex& v1, const Vertex& v2, float alpha, float beta, float gamma,
+		const CameraController& camera, bool& has_face_color, Color& face_color) {
+		if (shading_mode_ == ShadingMode::FLAT) {
+			if (!has_face_color) {
+				Vector3<float> face_normal = (v1.normal + v2.normal + v0.normal).normalized();
+				face_color = lighting_->calculate_color(face_normal, camera.position);
+				has_face_color = true;
+			}
+			return face_color;
+		}
+		if (shading_mode_ == ShadingMode::GOURAUD) {
+			auto interp = [&](uint8_t ca, uint8_t cb, uint8_t cc) -> uint8_t {
+				return static_cast<uint8_t>(
+					alpha * static_cast<float>(ca) +
+					beta * static_cast<float>(cb) +
+					gamma * static_cast<float>(cc));
+				};
+			return Color(
+				interp(v0.color.r, v1.color.r, v2.color.r),
+				interp(v0.color.g, v1.color.g, v2.color.g),
+				interp(v0.color.b, v1.color.b, v2.color.b));
+		}
+		Vector3<float> interpolated_normal =
+			(v0.normal * alpha + v1.normal * beta + v2.normal * gamma).normalized();
+		++stats_.shading_evaluations;
+		return lighting_->calculate_color(interpolated_normal, camera.position);
+	}
+
+	// Keys each drawable triangle by its nearest vertex depth and draws them in key order.
+	void draw_sorted(const Mesh& mesh, const std::optional<Vertex>* projected_vertices, const CameraController& camera) {
+		LinearArena* scratch = frame_arena_ ? &frame_arena_->main() : nullptr;
+		if (!scratch) {
+			if (!sort_scratch_) sort_scratch_ = std::make_unique<LinearArena>();
+			sort_scratch_->reset();
+			scratch = sort_scratch_.get();
+		}
+
+		const size_t face_count = mesh.face_count();
+		uint32_t* keys = scratch->allocate_array<uint32_t>(face_count);
+		uint32_t* order = scratch->allocate_array<uint32_t>(face_count);
+		uint32_t* triangles = scratch->allocate_array<uint32_t>(face_count * 3);
+		size_t count = 0;
+		mesh.for_each_face([&](uint32_t v1, uint32_t v2, uint32_t v3) {
+			const auto& a = projected_vertices[v1];
+			const auto& b = projected_vertices[v2];
+			const auto& c = projected_vertices[v3];
+			if (!a || !b || !c) return;
+			keys[count] = float_sort_key(std::min({ a->z, b->z, c->z }));
+			order[count] = static_cast<uint32_t>(count);
+			triangles[count * 3] = v1;
+			triangles[count * 3 + 1] = v2;
+			triangles[count * 3 + 2] = v3;
+			++count;
+		});
+
+		sorter_->sort(keys, order, count, *scratch);
+
+		for (size_t i = 0; i < count; ++i) {
+			const uint32_t* face = triangles + order[i] * 3;
+			submit_triangle(projected_vertices[face[2]].value(), projected_vertices[face[1]].value(), projected_vertices[face[0]].value(), camera);
+		}
+		flush_micro_triangles(camera);
+	}
+
+	// Depth testing stays per pixel; only the lighting evaluation is shared. The
+	// interpolated normal is affine in screen space, so its largest deviation across a
+	// block follows from its screen-space gradient. A 4x4 screen-aligned block is shaded
+	// once at its centre when that deviation stays under the threshold angle and the
+	// block is clear of the specular highlight. Otherwise each 2x2 quarter gets the same
+	// test, and quarters that fail it are shaded per pixel.
+	void draw_triangle_coarse_phong(const Vertex& v0, const Vertex& v1, const Vertex& v2, const CameraController& camera,
+		int xmin, int ymin, int xmax, int ymax, float area) {
+		const Vector2<float> a = v0.position;
+		const Vector2<float> b = v1.position;
+		const Vector2<float> c = v2.position;
+		const DepthPlane plane{ a, b, c, area, v0.z, v1.z, v2.z };
+
+		xmin = std::max(xmin, 0);
+		ymin = std::max(ymin, 0);
+		xmax = std::min(xmax, width_ - 1);
+		ymax = std::min(ymax, height_ - 1);
+
+		auto normal_at = [&](float x, float y) {
+			Vector2<float> p(x, y);
+			float alpha = getDeterminant(b, c, p) / area;
+			float beta = getDeterminant(c, a, p) / area;
+			float gamma = getDeterminant(a, b, p) / area;
+			return v0.normal * alpha + v1.normal * beta + v2.normal * gamma;
+		};
+
+		const Vector3<float> dndx = (v0.normal * (b.y - c.y) + v1.normal * (c.y - a.y) + v2.normal * (a.y - b.y)) / area;
+		const Vector3<float> dndy = (v0.normal * (c.x - b.x) + v1.normal * (a.x - c.x) + v2.normal * (b.x - a.x)) / area;
+		const float gradient = dndx.length() + dndy.length();
+		const float max_angle = std::acos(coarse_shading_cos_);
+		const float tan_max_angle = std::tan(max_angle);
+
+		// Reflections of normals within max_angle of the centre lie within twice that of
+		// the centre's reflection, so one test at the centre clears the whole block.
+		const float highlight_angle = std::acos(lighting_->highlight_cutoff()) - 2.0f * max_angle;
+		const float block_cutoff = highlight_angle > 0.0f ? std::cos(highlight_angle) : -2.0f;
+		const Vector3<float> view_dir = camera.position.normalized();
+
+		auto is_smooth = [&](int size, const Vector3<float>& centre) {
+			if (gradient * static_cast<float>(size - 1) * 0.5f > tan_max_angle * centre.length()) return false;
+			return lighting_->reflect_light(centre).dot(view_dir) < block_cutoff;
+		};
+
+		auto fill = [&](int x, int y, int size, uint16_t mask, const Color& color) {
+			for (int j = 0; j < size; ++j)
+				for (int i = 0; i < size; ++i)
+					if (mask & (1u << (j * 4 + i))) {
+						framebuffer_->set_pixel(x + i, y + j, color);
+						++stats_.pixels_written;
+					}
+		};
+
+		auto shade_per_pixel = [&](int x, int y, uint16_t mask) {
+			for (int j = 0; j < 2; ++j)
+				for (int i = 0; i < 2; ++i)
+					if (mask & (1u << (j * 4 + i))) {
+						Vector3<float> normal = normal_at(static_cast<float>(x + i), static_cast<float>(y + j)).normalized();
+						framebuffer_->set_pixel(x + i, y + j, lighting_->calculate_color(normal, camera.position));
+						++stats_.shading_evaluations;
+						++stats_.pixels_written;
+					}
+		};
+
+		for (int by = ymin & ~3; by <= ymax; by += 4) {
+			for (int bx = xmin & ~3; bx <= xmax; bx += 4) {
+				// Bit j * 4 + i is set when pixel (bx + i, by + j) passed coverage and depth.
+				uint16_t mask = 0;
+				for (int j = 0; j < 4; ++j) {
+					const int y = by + j;
+					if (y < ymin || y > ymax) continue;
+					for (int i = 0; i < 4; ++i) {
+						const int x = bx + i;
+						if (x < xmin || x > xmax) continue;
+						Vector2 p(x, y);
+
+						float w0 = getDeterminant(b, c, p);
+						float w1 = getDeterminant(c, a, p);
+						float w2 = getDeterminant(a, b, p);
+						if (w0 >= 0 && w1 >= 0 && w2 >= 0) {
+							float alpha = w0 / area;
+							float beta = w1 / area;
+							float gamma = w2 / area;
+							if (depth_buffer_->test_and_set(x, y, plane.depth(alpha, beta, gamma))) {
+								mask |= static_cast<uint16_t>(1u << (j * 4 + i));
+							}
 						}
+					}
+				}
+				if (!mask) continue;
 
-						framebuffer_->set_pixel(x, y, color);
-						depth_buffer_[y * width_ + x] = z;
+				const Vector3<float> centre = normal_at(static_cast<float>(bx) + 1.5f, static_cast<float>(by) + 1.5f);
+				if (is_smooth(4, centre)) {
+					fill(bx, by, 4, mask, lighting_->calculate_color(centre.normalized(), camera.position));
+					++stats_.shading_evaluations;
+					continue;
+				}
+
+				for (int quarter = 0; quarter < 4; ++quarter) {
+					const int qx = (quarter & 1) * 2;
+					const int qy = (quarter >> 1) * 2;
+					const uint16_t quarter_mask = static_cast<uint16_t>((mask >> (qy * 4 + qx)) & 0x33);
+					if (!quarter_mask) continue;
+
+					const Vector3<float> quarter_centre = normal_at(static_cast<float>(bx + qx) + 0.5f, static_cast<float>(by + qy) + 0.5f);
+					if (is_smooth(2, quarter_centre)) {
+						fill(bx + qx, by + qy, 2, quarter_mask, lighting_->calculate_color(quarter_centre.normalized(), camera.position));
+						++stats_.shading_evaluations;
+					}
+					else {
+						shade_per_pixel(bx + qx, by + qy, quarter_mask);
 					}
 				}
 			}
 		}
 	}
 
-private:
 	static float getDeterminant(const Vector2<float>& a, const Vector2<float>& b, const Vector2<float>& c) {
 		return (a.x - c.x) * (b.y - c.y) - (b.x - c.x) * (a.y - c.y);
 	}
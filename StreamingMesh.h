@@ -0,0 +1,648 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "MappedFile.h"
+#include "Matrix.h"
+#include "Mesh.h"
+#include "QuantizedMesh.h"
+
+// Chunk files: an OBJ split into spatially coherent pieces, each stored as a serialized
+// QuantizedMesh together with a vertex-clustered placeholder. Layout: FileHeader, then
+// chunk_count ChunkRecords, then the blobs they point at.
+namespace mesh_chunks {
+
+constexpr uint32_t kMagic = 0x43354350;
+constexpr uint32_t kVersion = 2;
+
+struct FileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t chunk_count;
+	uint32_t reserved;
+	float bounds_min[3];
+	float bounds_max[3];
+};
+
+struct ChunkRecord {
+	float bounds_min[3];
+	float bounds_max[3];
+	uint64_t fine_offset;
+	uint64_t fine_size;
+	uint64_t coarse_offset;
+	uint64_t coarse_size;
+	uint32_t fine_triangles;
+	uint32_t coarse_triangles;
+};
+
+struct BuildOptions {
+	// Faces per chunk the spatial grid aims for; a grid cell holding more than twice
+	// this is split further into runs of consecutive faces.
+	size_t target_chunk_faces = 32768;
+	// Clustering cells per axis for the placeholder of each chunk.
+	int coarse_grid = 12;
+	NormalEncoding normal_encoding = NormalEncoding::OCT8;
+};
+
+struct BuildStats {
+	uint64_t vertices = 0;
+	uint64_t faces = 0;
+	uint32_t chunks = 0;
+};
+
+namespace detail {
+
+// Removes the scratch directory however build() exits.
+struct ScratchDirectory {
+	std::filesystem::path path;
+	~ScratchDirectory() {
+		std::error_code ignored;
+		std::filesystem::remove_all(path, ignored);
+	}
+};
+
+// Parses "v" and "f" lines straight from the line buffer. Faces are fan-triangulated,
+// indices may be negative (relative), and only the position index of "v/vt/vn" is used.
+inline bool parse_obj(const std::string& path, std::ofstream& vertex_out, std::ofstream& face_out,
+	uint64_t& vertex_count, uint64_t& face_count, Vector3<float>& bounds_min, Vector3<float>& bounds_max) {
+	std::ifstream file(path);
+	if (!file.is_open()) return false;
+
+	bounds_min = Vector3<float>(HUGE_VALF, HUGE_VALF, HUGE_VALF);
+	bounds_max = Vector3<float>(-HUGE_VALF, -HUGE_VALF, -HUGE_VALF);
+	std::string line;
+	std::vector<uint32_t> polygon;
+	while (std::getline(file, line)) {
+		const char* p = line.c_str();
+		while (*p == ' ' || *p == '\t') ++p;
+		if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			char* end = nullptr;
+			float xyz[3];
+			p += 1;
+			for (float& value : xyz) {
+				value = std::strtof(p, &end);
+				p = end;
+			}
+			vertex_out.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+			bounds_min = Vector3<float>(std::min(bounds_min.x, xyz[0]), std::min(bounds_min.y, xyz[1]), std::min(bounds_min.z, xyz[2]));
+			bounds_max = Vector3<float>(std::max(bounds_max.x, xyz[0]), std::max(bounds_max.y, xyz[1]), std::max(bounds_max.z, xyz[2]));
+			++vertex_count;
+		}
+		else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			polygon.clear();
+			p += 1;
+			while (true) {
+				char* end = nullptr;
+				const long index = std::strtol(p, &end, 10);
+				if (end == p) break;
+				const long absolute = index < 0 ? static_cast<long>(vertex_count) + index : index - 1;
+				if (absolute < 0 || static_cast<uint64_t>(absolute) >= vertex_count) return false;
+				polygon.push_back(static_cast<uint32_t>(absolute));
+				p = end;
+				while (*p && *p != ' ' && *p != '\t') ++p;
+			}
+			for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+				const uint32_t face[3] = { polygon[0], polygon[i], polygon[i + 1] };
+				face_out.write(reinterpret_cast<const char*>(face), sizeof(face));
+				++face_count;
+			}
+		}
+	}
+	return true;
+}
+
+// Pulls the referenced vertices out of the mapped position file into a standalone mesh.
+inline Mesh gather(const uint32_t* faces, size_t face_count, const float* positions) {
+	Mesh mesh;
+	std::unordered_map<uint32_t, int> local;
+	local.reserve(face_count);
+	mesh.faces.reserve(face_count);
+	for (size_t f = 0; f < face_count; ++f) {
+		int corner[3];
+		for (int k = 0; k < 3; ++k) {
+			const uint32_t global = faces[f * 3 + k];
+			auto [it, inserted] = local.emplace(global, static_cast<int>(mesh.vertices.size()));
+			if (inserted) {
+				const float* p = positions + static_cast<size_t>(global) * 3;
+				mesh.vertices.emplace_back(p[0], p[1], p[2]);
+			}
+			corner[k] = it->second;
+		}
+		mesh.faces.emplace_back(corner[0], corner[1], corner[2]);
+	}
+	mesh.calculate_normals();
+	mesh.compute_bounds();
+	return mesh;
+}
+
+// Vertex clustering: vertices in the same grid cell merge into their mean, and faces
+// that collapse are dropped.
+inline Mesh cluster(const Mesh& fine, int grid) {
+	const Vector3<float> extent = fine.bounds_max - fine.bounds_min;
+	auto cell_of = [&](const Vector3<float>& p) {
+		auto axis = [grid](float value, float origin, float size) {
+			if (size <= 0.0f) return 0;
+			return std::min(grid - 1, static_cast<int>((value - origin) / size * static_cast<float>(grid)));
+		};
+		return (axis(p.z, fine.bounds_min.z, extent.z) * grid + axis(p.y, fine.bounds_min.y, extent.y)) * grid +
+			axis(p.x, fine.bounds_min.x, extent.x);
+	};
+
+	Mesh coarse;
+	std::unordered_map<int, int> cluster_of_cell;
+	std::vector<int> cluster_of_vertex(fine.vertices.size());
+	std::vector<int> members;
+	for (size_t i = 0; i < fine.vertices.size(); ++i) {
+		auto [it, inserted] = cluster_of_cell.emplace(cell_of(fine.vertices[i]), static_cast<int>(coarse.vertices.size()));
+		if (inserted) {
+			coarse.vertices.emplace_back(0.0f, 0.0f, 0.0f);
+			members.push_back(0);
+		}
+		coarse.vertices[it->second] += fine.vertices[i];
+		++members[it->second];
+		cluster_of_vertex[i] = it->second;
+	}
+	for (size_t c = 0; c < coarse.vertices.size(); ++c)
+		coarse.vertices[c] = coarse.vertices[c] * (1.0f / static_cast<float>(members[c]));
+
+	for (const auto& face : fine.faces) {
+		const int a = cluster_of_vertex[face.x];
+		const int b = cluster_of_vertex[face.y];
+		const int c = cluster_of_vertex[face.z];
+		if (a != b && b != c && a != c)
+			coarse.faces.emplace_back(a, b, c);
+	}
+	coarse.calculate_normals();
+	coarse.compute_bounds();
+	return coarse;
+}
+
+}
+
+// Converts an OBJ of any size into a chunk file using bounded memory: positions and
+// faces are first streamed to scratch files, the positions are memory-mapped for
+// random access, and faces are bucketed by centroid into a uniform grid on disk before
+// each bucket is turned into a chunk. Normals are computed per chunk, so shading may
+// show faint seams along chunk borders. The file is written beside output_path and only
+// renamed into place once complete, so a failed build never leaves a truncated file.
+inline bool build(const std::string& obj_path, const std::string& output_path, const BuildOptions& options = {}, BuildStats* stats = nullptr) {
+	namespace fs = std::filesystem;
+	detail::ScratchDirectory scratch{ fs::temp_directory_path() / ("pc5_chunks_" +
+		std::to_string(std::hash<std::string>{}(output_path)) + "_" +
+		std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())) };
+	fs::create_directories(scratch.path);
+	const std::string vertex_path = (scratch.path / "vertices.bin").string();
+	const std::string face_path = (scratch.path / "faces.bin").string();
+
+	uint64_t vertex_count = 0, face_count = 0;
+	Vector3<float> bounds_min, bounds_max;
+	{
+		std::ofstream vertex_out(vertex_path, std::ios::binary);
+		std::ofstream face_out(face_path, std::ios::binary);
+		if (!detail::parse_obj(obj_path, vertex_out, face_out, vertex_count, face_count, bounds_min, bounds_max)) {
+			std::cerr << "Error: Cannot read OBJ file: " << obj_path << "\n";
+			return false;
+		}
+	}
+	if (vertex_count == 0 || face_count == 0) return false;
+
+	MappedFile vertex_file(vertex_path);
+	if (!vertex_file.is_open()) return false;
+	const float* positions = reinterpret_cast<const float*>(vertex_file.data());
+
+	const size_t target = std::max<size_t>(options.target_chunk_faces, 1);
+	const int grid = std::clamp(static_cast<int>(std::ceil(std::cbrt(static_cast<double>(face_count) / static_cast<double>(target)))), 1, 16);
+	const Vector3<float> extent = bounds_max - bounds_min;
+	auto axis = [grid](float value, float origin, float size) {
+		if (size <= 0.0f) return 0;
+		return std::clamp(static_cast<int>((value - origin) / size * static_cast<float>(grid)), 0, grid - 1);
+	};
+
+	// Bucket faces by centroid cell, spilling each bucket to its own file when it fills.
+	constexpr size_t kBucketFaces = 1024;
+	const size_t cell_count = static_cast<size_t>(grid) * grid * grid;
+	std::vector<std::vector<uint32_t>> buckets(cell_count);
+	std::vector<uint64_t> bucket_faces(cell_count, 0);
+	auto bucket_path = [&](size_t cell) { return (scratch.path / ("cell_" + std::to_string(cell) + ".bin")).string(); };
+	auto spill = [&](size_t cell) {
+		std::ofstream out(bucket_path(cell), std::ios::binary | std::ios::app);
+		out.write(reinterpret_cast<const char*>(buckets[cell].data()), static_cast<std::streamsize>(buckets[cell].size() * sizeof(uint32_t)));
+		buckets[cell].clear();
+	};
+	{
+		std::ifstream face_in(face_path, std::ios::binary);
+		std::vector<uint32_t> block(3 * 65536);
+		while (face_in) {
+			face_in.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(block.size() * sizeof(uint32_t)));
+			const size_t read = static_cast<size_t>(face_in.gcount()) / (3 * sizeof(uint32_t));
+			for (size_t f = 0; f < read; ++f) {
+				Vector3<float> centroid(0.0f, 0.0f, 0.0f);
+				for (int k = 0; k < 3; ++k) {
+					const float* p = positions + static_cast<size_t>(block[f * 3 + k]) * 3;
+					centroid += Vector3<float>(p[0], p[1], p[2]);
+				}
+				centroid = centroid * (1.0f / 3.0f);
+				const size_t cell = (static_cast<size_t>(axis(centroid.z, bounds_min.z, extent.z)) * grid +
+					axis(centroid.y, bounds_min.y, extent.y)) * grid + axis(centroid.x, bounds_min.x, extent.x);
+				buckets[cell].insert(buckets[cell].end(), block.data() + f * 3, block.data() + f * 3 + 3);
+				++bucket_faces[cell];
+				if (buckets[cell].size() >= kBucketFaces * 3) spill(cell);
+			}
+		}
+		for (size_t cell = 0; cell < cell_count; ++cell)
+			if (!buckets[cell].empty()) spill(cell);
+		std::vector<std::vector<uint32_t>>().swap(buckets);
+	}
+
+	// Turn each bucket into one or more chunks; blobs go to a scratch file until the
+	// table size is known.
+	const std::string blob_path = (scratch.path / "blobs.bin").string();
+	std::vector<ChunkRecord> records;
+	{
+		std::ofstream blobs(blob_path, std::ios::binary);
+		uint64_t offset = 0;
+		std::vector<uint8_t> bytes;
+		auto write_blob = [&](const Mesh& mesh, uint64_t& blob_offset, uint64_t& blob_size) {
+			bytes.clear();
+			mesh.quantized->serialize(bytes);
+			blobs.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			blob_offset = offset;
+			blob_size = bytes.size();
+			offset += bytes.size();
+		};
+
+		std::vector<uint32_t> faces;
+		for (size_t cell = 0; cell < cell_count; ++cell) {
+			if (bucket_faces[cell] == 0) continue;
+			faces.resize(static_cast<size_t>(bucket_faces[cell]) * 3);
+			std::ifstream in(bucket_path(cell), std::ios::binary);
+			in.read(reinterpret_cast<char*>(faces.data()), static_cast<std::streamsize>(faces.size() * sizeof(uint32_t)));
+			in.close();
+			fs::remove(bucket_path(cell));
+
+			const size_t total = faces.size() / 3;
+			const size_t pieces = (total + 2 * target - 1) / (2 * target);
+			for (size_t piece = 0; piece < pieces; ++piece) {
+				const size_t first = total * piece / pieces;
+				const size_t end = total * (piece + 1) / pieces;
+				Mesh fine = detail::gather(faces.data() + first * 3, end - first, positions);
+				Mesh coarse = detail::cluster(fine, options.coarse_grid);
+
+				ChunkRecord record{};
+				for (int k = 0; k < 3; ++k) {
+					record.bounds_min[k] = k == 0 ? fine.bounds_min.x : k == 1 ? fine.bounds_min.y : fine.bounds_min.z;
+					record.bounds_max[k] = k == 0 ? fine.bounds_max.x : k == 1 ? fine.bounds_max.y : fine.bounds_max.z;
+				}
+				record.fine_triangles = static_cast<uint32_t>(fine.faces.size());
+				record.coarse_triangles = static_cast<uint32_t>(coarse.faces.size());
+				fine.quantize(options.normal_encoding);
+				coarse.quantize(options.normal_encoding);
+				write_blob(fine, record.fine_offset, record.fine_size);
+				write_blob(coarse, record.coarse_offset, record.coarse_size);
+				records.push_back(record);
+			}
+		}
+	}
+
+	FileHeader header{ kMagic, kVersion, static_cast<uint32_t>(records.size()), 0,
+		{ bounds_min.x, bounds_min.y, bounds_min.z }, { bounds_max.x, bounds_max.y, bounds_max.z } };
+	const uint64_t data_start = sizeof(FileHeader) + records.size() * sizeof(ChunkRecord);
+	for (auto& record : records) {
+		record.fine_offset += data_start;
+		record.coarse_offset += data_start;
+	}
+
+	const std::string temp_path = output_path + ".tmp";
+	{
+		std::ofstream out(temp_path, std::ios::binary);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(ChunkRecord)));
+		std::ifstream blobs(blob_path, std::ios::binary);
+		out << blobs.rdbuf();
+		out.close();
+		std::error_code error;
+		if (!out.fail()) fs::rename(temp_path, output_path, error);
+		if (out.fail() || error) {
+			fs::remove(temp_path, error);
+			return false;
+		}
+	}
+
+	if (stats) *stats = { vertex_count, face_count, static_cast<uint32_t>(records.size()) };
+	return true;
+}
+
+// Whether chunk_path holds a chunk file of this version that is no older than the OBJ it
+// was built from, i.e. whether build() can be skipped.
+inline bool is_up_to_date(const std::string& chunk_path, const std::string& obj_path) {
+	namespace fs = std::filesystem;
+	std::error_code error;
+	const auto chunk_time = fs::last_write_time(chunk_path, error);
+	if (error) return false;
+	const auto obj_time = fs::last_write_time(obj_path, error);
+	if (error || chunk_time < obj_time) return false;
+
+	std::ifstream file(chunk_path, std::ios::binary);
+	FileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != kMagic || header.version != kVersion)
+		return false;
+	const uint64_t size = fs::file_size(chunk_path, error);
+	return !error && sizeof(header) + static_cast<uint64_t>(header.chunk_count) * sizeof(ChunkRecord) <= size;
+}
+
+}
+
+// Draws a chunk file without loading it whole. Every chunk's placeholder stays resident
+// and is counted against the memory budget; full-detail chunks are paged in by a
+// background thread from the mapped file, visible ones nearest the eye first, into what
+// the placeholders leave of it. When room is needed the least recently visible chunk is
+// evicted. Chunks are compact meshes, which a Renderer with a frame arena projects
+// through per-frame scratch rather than its transform cache, so the budget covers
+// everything a resident chunk holds.
+class StreamingMesh {
+public:
+	struct Stats {
+		uint32_t chunks = 0;
+		uint32_t visible = 0;
+		uint32_t detailed = 0;		// visible and drawn at full detail
+		uint32_t resident = 0;
+		uint32_t loading = 0;
+		uint64_t resident_bytes = 0;	// placeholders plus resident full-detail chunks
+		uint64_t loads = 0;
+		uint64_t evictions = 0;
+		uint32_t failed = 0;		// chunks whose detail could not be read; drawn as placeholders
+	};
+
+	// Called with a full-detail chunk just before it is freed.
+	using EvictCallback = std::function<void(const Mesh&)>;
+
+private:
+	struct Chunk {
+		mesh_chunks::ChunkRecord record;
+		std::unique_ptr<Mesh> coarse;
+		std::unique_ptr<Mesh> fine;
+		bool requested = false;
+		bool failed = false;
+		bool visible = false;
+		uint64_t last_visible = 0;
+	};
+
+	struct Loaded {
+		uint32_t index = 0;
+		std::unique_ptr<Mesh> mesh;
+	};
+
+	static constexpr size_t kMaxInFlight = 4;
+
+	MappedFile file_;
+	std::vector<Chunk> chunks_;
+	Vector3<float> bounds_min_;
+	Vector3<float> bounds_max_;
+	Matrix4 transform_ = Matrix4::identity();
+	size_t budget_bytes_;
+	size_t resident_bytes_ = 0;
+	size_t in_flight_bytes_ = 0;
+	size_t in_flight_ = 0;
+	uint64_t frame_ = 0;
+	Stats stats_;
+	EvictCallback on_evict_;
+
+	std::thread loader_;
+	std::mutex mutex_;
+	std::condition_variable requests_cv_;
+	std::condition_variable space_cv_;
+	std::deque<uint32_t> requests_;
+	std::atomic<bool> parked_{ false };
+	std::atomic<bool> stopping_{ false };
+	LockFreeQueue<Loaded> finished_{ kMaxInFlight * 2 };
+
+	std::unique_ptr<Mesh> read_chunk(const mesh_chunks::ChunkRecord& record, bool fine) const {
+		auto mesh = std::make_unique<Mesh>();
+		mesh->quantized = std::make_unique<QuantizedMesh>();
+		const uint64_t offset = fine ? record.fine_offset : record.coarse_offset;
+		const uint64_t size = fine ? record.fine_size : record.coarse_size;
+		if (offset + size > file_.size() || !mesh->quantized->deserialize(file_.data() + offset, static_cast<size_t>(size)))
+			return nullptr;
+		mesh->bounds_min = Vector3<float>(record.bounds_min[0], record.bounds_min[1], record.bounds_min[2]);
+		mesh->bounds_max = Vector3<float>(record.bounds_max[0], record.bounds_max[1], record.bounds_max[2]);
+		return mesh;
+	}
+
+	void loader_loop() {
+		while (true) {
+			uint32_t index;
+			{
+				std::unique_lock lock(mutex_);
+				requests_cv_.wait(lock, [this] { return stopping_ || !requests_.empty(); });
+				if (stopping_) return;
+				index = requests_.front();
+				requests_.pop_front();
+			}
+			// Copying out of the mapping is where the OS pages the chunk in.
+			Loaded loaded{ index, read_chunk(chunks_[index].record, true) };
+			if (finished_.try_push(loaded)) continue;
+			// The ring holds twice the loads update() lets into flight, so this only happens if
+			// that bound changes; park until update() takes a result. update() notifies without
+			// the lock, so the wait also rechecks on a short timeout.
+			bool pushed = false;
+			std::unique_lock lock(mutex_);
+			parked_ = true;
+			while (!space_cv_.wait_for(lock, std::chrono::milliseconds(5), [&] { return (pushed = finished_.try_push(loaded)) || stopping_; })) {}
+			parked_ = false;
+			if (!pushed) return;
+		}
+	}
+
+	// The box is outside when all eight corners lie beyond the same clip plane.
+	static bool in_frustum(const Matrix4& mvp, const float* lo, const float* hi) {
+		int outside[6] = {};
+		for (int corner = 0; corner < 8; ++corner) {
+			const Vector4<float> c = mvp * Vector4<float>((corner & 1) ? hi[0] : lo[0], (corner & 2) ? hi[1] : lo[1], (corner & 4) ? hi[2] : lo[2], 1.0f);
+			outside[0] += c.x < -c.w;
+			outside[1] += c.x > c.w;
+			outside[2] += c.y < -c.w;
+			outside[3] += c.y > c.w;
+			outside[4] += c.z < -c.w;
+			outside[5] += c.z > c.w;
+		}
+		for (int plane : outside)
+			if (plane == 8) return false;
+		return true;
+	}
+
+	void evict(Chunk& chunk) {
+		if (on_evict_) on_evict_(*chunk.fine);
+		resident_bytes_ -= chunk.fine->quantized->size_bytes();
+		chunk.fine.reset();
+		++stats_.evictions;
+	}
+
+	// Evicts chunks that are not visible this frame, least recently visible first,
+	// until bytes more would fit in the budget.
+	bool make_room(size_t bytes) {
+		while (resident_bytes_ + in_flight_bytes_ + bytes > budget_bytes_) {
+			Chunk* victim = nullptr;
+			for (auto& chunk : chunks_)
+				if (chunk.fine && !chunk.visible && (!victim || chunk.last_visible < victim->last_visible))
+					victim = &chunk;
+			if (!victim) return false;
+			evict(*victim);
+		}
+		return true;
+	}
+
+public:
+	StreamingMesh(const std::string& chunk_path, size_t budget_bytes, EvictCallback on_evict = {})
+		: budget_bytes_(budget_bytes), on_evict_(std::move(on_evict)) {
+		if (!file_.open(chunk_path) || file_.size() < sizeof(mesh_chunks::FileHeader)) return;
+		mesh_chunks::FileHeader header;
+		std::memcpy(&header, file_.data(), sizeof(header));
+		if (header.magic != mesh_chunks::kMagic || header.version != mesh_chunks::kVersion ||
+			sizeof(header) + static_cast<uint64_t>(header.chunk_count) * sizeof(mesh_chunks::ChunkRecord) > file_.size())
+			return;
+		bounds_min_ = Vector3<float>(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]);
+		bounds_max_ = Vector3<float>(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]);
+
+		chunks_.resize(header.chunk_count);
+		for (uint32_t i = 0; i < header.chunk_count; ++i) {
+			std::memcpy(&chunks_[i].record, file_.data() + sizeof(header) + i * sizeof(mesh_chunks::ChunkRecord), sizeof(mesh_chunks::ChunkRecord));
+			chunks_[i].coarse = read_chunk(chunks_[i].record, false);
+			if (!chunks_[i].coarse) {
+				chunks_.clear();
+				return;
+			}
+			resident_bytes_ += chunks_[i].coarse->quantized->size_bytes();
+		}
+		stats_.chunks = header.chunk_count;
+		loader_ = std::thread(&StreamingMesh::loader_loop, this);
+	}
+
+	~StreamingMesh() {
+		{
+			std::lock_guard lock(mutex_);
+			stopping_ = true;
+		}
+		requests_cv_.notify_all();
+		space_cv_.notify_all();
+		if (loader_.joinable())
+			loader_.join();
+	}
+
+	StreamingMesh(const StreamingMesh&) = delete;
+	StreamingMesh& operator=(const StreamingMesh&) = delete;
+
+	bool is_open() const { return !chunks_.empty(); }
+	const Vector3<float>& bounds_min() const { return bounds_min_; }
+	const Vector3<float>& bounds_max() const { return bounds_max_; }
+
+	void set_transform(const Matrix4& transform) {
+		transform_ = transform;
+		for (auto& chunk : chunks_) {
+			chunk.coarse->transform = transform;
+			if (chunk.fine) chunk.fine->transform = transform;
+		}
+	}
+
+	void set_budget_bytes(size_t budget_bytes) { budget_bytes_ = budget_bytes; }
+
+	// Once per frame before drawing: takes finished loads, works out the visible set
+	// and queues loads for it. Returns true if any chunk changed level of detail.
+	bool update(const Matrix4& view_proj, const Vector3<float>& eye) {
+		++frame_;
+		bool changed = false;
+		Loaded loaded;
+		while (finished_.try_pop(loaded)) {
+			if (parked_) space_cv_.notify_one();
+			Chunk& chunk = chunks_[loaded.index];
+			in_flight_bytes_ -= static_cast<size_t>(chunk.record.fine_size);
+			--in_flight_;
+			chunk.requested = false;
+			if (!loaded.mesh) {
+				// A damaged blob stays damaged; keep the placeholder rather than retrying.
+				chunk.failed = true;
+				++stats_.failed;
+				continue;
+			}
+			chunk.fine = std::move(loaded.mesh);
+			chunk.fine->transform = transform_;
+			resident_bytes_ += chunk.fine->quantized->size_bytes();
+			++stats_.loads;
+			changed = true;
+		}
+
+		const Matrix4 mvp = view_proj * transform_;
+		std::vector<std::pair<float, uint32_t>> wanted;
+		stats_.visible = 0;
+		for (uint32_t i = 0; i < chunks_.size(); ++i) {
+			Chunk& chunk = chunks_[i];
+			chunk.visible = in_frustum(mvp, chunk.record.bounds_min, chunk.record.bounds_max);
+			if (!chunk.visible) continue;
+			chunk.last_visible = frame_;
+			++stats_.visible;
+			if (!chunk.fine && !chunk.requested && !chunk.failed) {
+				const Vector4<float> centre = transform_ * Vector4<float>(
+					(chunk.record.bounds_min[0] + chunk.record.bounds_max[0]) * 0.5f,
+					(chunk.record.bounds_min[1] + chunk.record.bounds_max[1]) * 0.5f,
+					(chunk.record.bounds_min[2] + chunk.record.bounds_max[2]) * 0.5f, 1.0f);
+				wanted.emplace_back((Vector3<float>(centre.x, centre.y, centre.z) - eye).length(), i);
+			}
+		}
+		std::sort(wanted.begin(), wanted.end());
+
+		for (const auto& [distance, index] : wanted) {
+			if (in_flight_ >= kMaxInFlight) break;
+			Chunk& chunk = chunks_[index];
+			const size_t bytes = static_cast<size_t>(chunk.record.fine_size);
+			if (!make_room(bytes)) break;
+			chunk.requested = true;
+			in_flight_bytes_ += bytes;
+			++in_flight_;
+			{
+				std::lock_guard lock(mutex_);
+				requests_.push_back(index);
+			}
+			requests_cv_.notify_one();
+		}
+		return changed;
+	}
+
+	// True while loads are queued or running.
+	bool busy() const { return in_flight_ > 0; }
+
+	// Calls f(mesh) for each visible chunk: full detail when resident, else its placeholder.
+	template<typename F>
+	void for_each_drawable(F&& f) const {
+		for (const auto& chunk : chunks_)
+			if (chunk.visible)
+				f(chunk.fine ? *chunk.fine : *chunk.coarse);
+	}
+
+	Stats stats() const {
+		Stats result = stats_;
+		for (const auto& chunk : chunks_) {
+			result.resident += chunk.fine != nullptr;
+			result.detailed += chunk.fine && chunk.visible;
+		}
+		result.loading = static_cast<uint32_t>(in_flight_);
+		result.resident_bytes = resident_bytes_;
+		return result;
+	}
+};
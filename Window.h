@@ -1,14 +1,30 @@
 ﻿#pragma once
 #include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/Clock.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
 #include <limits>
 #include <vector>
 #include <memory>
 
+#include "AssetLoader.h"
+#include "DynamicResolution.h"
 #include "CameraController.h"
+#include "DepthBuffer.h"
+#include "FrameArena.h"
+#include "FrameCapture.h"
+#include "FramePipeline.h"
 #include "Framebuffer.h"
 #include "Matrix.h"
 #include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "RadixSort.h"
+#include "StreamingMesh.h"
 #include "Lighting.h"
 #include "InputManager.h"
 #include "Renderer.h"
@@ -17,79 +33,279 @@ class Window {
 	unsigned int width_;
 	unsigned int height_;
 	sf::RenderWindow window_;
+	sf::Texture texture_;
+	sf::Sprite sprite_;
 	std::vector<std::unique_ptr<Mesh>> meshes_;
-	std::unique_ptr<Framebuffer> framebuffer_;
+	std::vector<std::unique_ptr<StreamingMesh>> streaming_meshes_;
 	std::unique_ptr<Lighting> lighting_;
 	std::unique_ptr<Renderer> renderer_;
-	float* depth_buffer_ = nullptr;
+	std::unique_ptr<DepthBuffer> depth_buffer_;
+	DepthFormat depth_format_ = DepthFormat::FLOAT32;
+	bool depth_compression_ = false;
 	float fps_ = 0.f;
 	sf::Clock clock_;
 	ShadingMode shading_mode_ = ShadingMode::PHONG;
 	ProjectionMode projection_mode_ = ProjectionMode::PERSPECTIVE;
 	InputManager input_manager_;
+	std::unique_ptr<AssetLoader> asset_loader_;
+	FrameArena frame_arena_;
+	std::unique_ptr<FrameCapture> capture_;
+	std::unique_ptr<DynamicResolution> dynamic_resolution_;
+	std::unique_ptr<OcclusionCuller> occlusion_culler_;
+	RadixSorter object_sorter_{ 1 };
+	std::unique_ptr<FramePipeline> pipeline_;
+	int frame_latency_ = 2;
+	bool close_requested_ = false;
+	float overdraw_ = 0.0f;
+	bool scene_dirty_ = true;
+	bool needs_present_ = false;
+	uint64_t lighting_revision_ = 0;
+	int failed_loads_ = 0;
 
-	Matrix4 get_projection_matrix() const {
-		if (projection_mode_ == ProjectionMode::PERSPECTIVE) {
-			return Matrix4::perspective(
-				90.0f * 3.1415f / 180.0f,
-				static_cast<float>(width_) / static_cast<float>(height_),
-				0.1f,
-				100.0f);
+	float aspect_ratio() const {
+		return static_cast<float>(width_) / static_cast<float>(height_);
+	}
+
+	// The presenter thread holds the window's GL context while the pipeline runs: it
+	// uploads each finished frame to the texture, swaps, and then hands the pixels to
+	// the capture, which takes them over.
+	void start_pipeline() {
+		FramePipeline::Callbacks callbacks;
+		callbacks.begin = [this] { (void)window_.setActive(true); };
+		callbacks.end = [this] { (void)window_.setActive(false); };
+		callbacks.present = [this](Framebuffer& frame) {
+			texture_.update(frame.data());
+			window_.draw(sprite_);
+			window_.display();
+			if (capture_)
+				capture_->submit(frame);
+		};
+		// Draws the last uploaded frame again without re-uploading the pixels.
+		callbacks.redisplay = [this] {
+			window_.draw(sprite_);
+			window_.display();
+		};
+		(void)window_.setActive(false);
+		pipeline_ = std::make_unique<FramePipeline>(width_, height_, frame_latency_, std::move(callbacks));
+	}
+
+	void handle_event(const sf::Event& event) {
+		if (event.is<sf::Event::Closed>())
+			close_requested_ = true;
+		else if (event.is<sf::Event::Resized>() || event.is<sf::Event::FocusGained>())
+			needs_present_ = true;
+		else if (const auto* key = event.getIf<sf::Event::KeyPressed>()) {
+			if (key->code == sf::Keyboard::Key::F5) {
+				if (capture_)
+					stop_capture();
+				else
+					start_capture("capture_" + std::to_string(std::time(nullptr)), ImageFormat::QOI);
+			}
+			else if (key->code == sf::Keyboard::Key::F7) {
+				renderer_->set_coarse_shading(!renderer_->coarse_shading());
+				scene_dirty_ = true;
+			}
+			else if (key->code == sf::Keyboard::Key::F8) {
+				if (occlusion_culler_)
+					occlusion_culler_.reset();
+				else
+					occlusion_culler_ = std::make_unique<OcclusionCuller>();
+				scene_dirty_ = true;
+			}
+			else if (key->code == sf::Keyboard::Key::F9) {
+				set_draw_order(renderer_->draw_order() == DrawOrder::FRONT_TO_BACK ? DrawOrder::SUBMISSION : DrawOrder::FRONT_TO_BACK);
+				scene_dirty_ = true;
+			}
+			else if (key->code == sf::Keyboard::Key::F10) {
+				set_depth_format(static_cast<DepthFormat>((static_cast<int>(depth_format_) + 1) % 3), depth_compression_);
+				scene_dirty_ = true;
+			}
+			else if (key->code == sf::Keyboard::Key::F11) {
+				set_depth_format(depth_format_, !depth_compression_);
+				scene_dirty_ = true;
+			}
+			else if (key->code == sf::Keyboard::Key::F12) {
+				set_frame_latency(frame_latency_ % 3 + 1);
+			}
+			else if (key->code == sf::Keyboard::Key::F6) {
+				if (dynamic_resolution_)
+					dynamic_resolution_.reset();
+				else
+					set_frame_time_budget(16.6f);
+				scene_dirty_ = true;
+			}
+		}
+	}
+
+	bool streaming_busy() const {
+		for (const auto& stream : streaming_meshes_)
+			if (stream->busy()) return true;
+		return false;
+	}
+
+	// Blocks until the OS delivers an event. While assets or chunks are still loading,
+	// wake up regularly so finished meshes are picked up without waiting for input.
+	void wait_for_event() {
+		const bool loading = asset_loader_->pending() > 0 || streaming_busy();
+		const sf::Time timeout = loading ? sf::milliseconds(10) : sf::milliseconds(100);
+		if (const std::optional event = window_.waitEvent(timeout))
+			handle_event(*event);
+		clock_.restart();
+	}
+
+	// Renders the scene into output, going through a scaled internal target when dynamic
+	// resolution is active. Only this render time feeds dynamic resolution: presenting
+	// overlaps the next frame, so it does not add to the frame time the scale controls.
+	void render_frame(const CameraController& camera, Framebuffer& output) {
+		sf::Clock render_clock;
+		frame_arena_.begin_frame();
+
+		Framebuffer* target = &output;
+		DepthBuffer* depth = depth_buffer_.get();
+		if (dynamic_resolution_ && dynamic_resolution_->scale() < 1.0f) {
+			RenderTarget& scaled = dynamic_resolution_->target(width_, height_);
+			target = scaled.framebuffer.get();
+			depth = &scaled.depth;
+		}
+		depth->set_format(depth_format_, depth_compression_);
+		renderer_->set_target(static_cast<int>(target->get_width()), static_cast<int>(target->get_height()), target, depth);
+
+		renderer_->set_shading_mode(shading_mode_);
+		renderer_->reset_stats();
+		renderer_->clear_depth();
+		target->clear(Color::Black);
+
+		Matrix4 view = camera.getViewMatrix();
+		Matrix4 proj = camera.getProjectionMatrix(projection_mode_, aspect_ratio());
+		Matrix4 view_proj = proj * view;
+
+		auto drawables = frame_arena_.make_vector<const Mesh*>(meshes_.size());
+		for (const auto& mesh : meshes_)
+			drawables.push_back(mesh.get());
+		for (const auto& stream : streaming_meshes_)
+			stream->for_each_drawable([&](const Mesh& mesh) { drawables.push_back(&mesh); });
+
+		if (occlusion_culler_) {
+			occlusion_culler_->begin_frame(static_cast<int>(target->get_width()), static_cast<int>(target->get_height()));
+			for (const Mesh* mesh : drawables)
+				occlusion_culler_->add_occluder(*mesh, view_proj * mesh->transform, frame_arena_.main());
+		}
+
+		for (uint32_t index : draw_sequence(drawables, view)) {
+			const Mesh& mesh = *drawables[index];
+			Matrix4 mvp = view_proj * mesh.transform;
+			if (occlusion_culler_ && !occlusion_culler_->is_visible(mesh, mvp))
+				continue;
+			renderer_->draw_mesh(mesh, mvp, view * mesh.transform, camera);
+		}
+		overdraw_ = renderer_->overdraw_ratio();
+
+		if (target != &output)
+			upscale_bilinear(*target, output, frame_arena_.main());
+
+		if (dynamic_resolution_)
+			dynamic_resolution_->record_frame(render_clock.getElapsedTime().asSeconds() * 1000.0f);
+	}
+
+	// Indices into drawables in submission order, or nearest bounds centre first when sorting.
+	ArenaVector<uint32_t> draw_sequence(const ArenaVector<const Mesh*>& drawables, const Matrix4& view) {
+		auto sequence = frame_arena_.make_vector<uint32_t>(drawables.size());
+		for (uint32_t i = 0; i < drawables.size(); ++i)
+			sequence.push_back(i);
+		if (renderer_->draw_order() != DrawOrder::FRONT_TO_BACK) return sequence;
+
+		auto keys = frame_arena_.make_vector<uint32_t>(drawables.size());
+		for (const Mesh* mesh : drawables) {
+			const Vector3<float> centre = (mesh->bounds_min + mesh->bounds_max) * 0.5f;
+			const Vector4<float> p = view * mesh->transform * Vector4<float>(centre.x, centre.y, centre.z, 1.0f);
+			keys.push_back(float_sort_key(Vector3<float>(p.x, p.y, p.z).length()));
+		}
+		object_sorter_.sort(keys.data(), sequence.data(), sequence.size(), frame_arena_.main());
+		return sequence;
+	}
+
+	bool poll_changes(CameraController& camera) {
+		bool dirty = scene_dirty_;
+		scene_dirty_ = false;
+
+		while (auto mesh = asset_loader_->try_take()) {
+			meshes_.push_back(std::move(mesh));
+			dirty = true;
+		}
+		if (asset_loader_->failed() != failed_loads_) {
+			failed_loads_ = asset_loader_->failed();
+			dirty = true;
+		}
+
+		dirty |= input_manager_.update_camera(camera);
+		dirty |= input_manager_.update(shading_mode_, projection_mode_);
+
+		if (!streaming_meshes_.empty()) {
+			const Matrix4 view_proj = camera.getProjectionMatrix(projection_mode_, aspect_ratio()) * camera.getViewMatrix();
+			for (const auto& stream : streaming_meshes_)
+				dirty |= stream->update(view_proj, camera.position);
 		}
-		else {
-			float aspect = static_cast<float>(width_) / static_cast<float>(height_);
-			float ortho_width = 10.0f;
-			float ortho_height = ortho_width / aspect;
-			return Matrix4::orthographic(
-				-ortho_width / 2, ortho_width / 2,
-				ortho_height / 2, -ortho_height / 2,
-				0.1f,
-				100.0f);
+
+		if (lighting_->revision() != lighting_revision_) {
+			lighting_revision_ = lighting_->revision();
+			dirty = true;
 		}
+		return dirty;
 	}
 
 public:
 	Window(const unsigned int width, const unsigned int height, const sf::String& title)
 		: width_(width), height_(height), window_(sf::VideoMode({ width, height }), title),
-		depth_buffer_(new float[width * height]), shading_mode_(ShadingMode::PHONG)
+		texture_(sf::Vector2u(width, height)), sprite_(texture_),
+		shading_mode_(ShadingMode::PHONG)
 	{
-		for (unsigned int i = 0; i < width * height; ++i)
-			depth_buffer_[i] = std::numeric_limits<float>::max();
-
+		depth_buffer_ = std::make_unique<DepthBuffer>(static_cast<int>(width), static_cast<int>(height));
 		clock_ = sf::Clock();
 		lighting_ = std::make_unique<Lighting>();
-		framebuffer_ = std::make_unique<Framebuffer>(width_, height_);
-		renderer_ = std::make_unique<Renderer>(width_, height_, framebuffer_.get(), depth_buffer_, lighting_.get(), shading_mode_);
+		// Color targets come from the frame pipeline and are set per frame.
+		renderer_ = std::make_unique<Renderer>(width_, height_, nullptr, depth_buffer_.get(), lighting_.get(), shading_mode_);
+		asset_loader_ = std::make_unique<AssetLoader>();
+		renderer_->set_frame_arena(&frame_arena_);
 	}
 
-	void run() {
+	// Returns false if it stopped because every model failed to load, leaving nothing to show.
+	bool run() {
 		auto camera = CameraController();
+		bool nothing_loaded = false;
+		start_pipeline();
 
-		while (window_.isOpen()) {
-			sf::Time delta_time = clock_.restart();
+		while (!close_requested_) {
+			while (const std::optional event = window_.pollEvent())
+				handle_event(*event);
 
-			while (const std::optional event = window_.pollEvent()) {
-				if (event->is<sf::Event::Closed>())
-					window_.close();
+			if (failed_loads_ > 0 && asset_loader_->pending() == 0 && meshes_.empty() && streaming_meshes_.empty()) {
+				std::cerr << "Error: no model could be loaded\n";
+				nothing_loaded = true;
+				break;
 			}
 
-			camera.handle_input();
-			input_manager_.update(shading_mode_, projection_mode_);
-			renderer_->set_shading_mode(shading_mode_);
-			renderer_->clear_depth();
-			framebuffer_->clear(sf::Color::Black);
-
-			Matrix4 model = Matrix4::identity();
-			Matrix4 view = camera.getViewMatrix();
-			Matrix4 proj = get_projection_matrix();
-			Matrix4 mvp = proj * view * model;
+			if (pipeline_->frames_in_flight() != frame_latency_) {
+				pipeline_.reset();
+				start_pipeline();
+			}
 
-			for (const auto& mesh : meshes_) {
-				renderer_->draw_mesh(*mesh, mvp, view, camera);
+			if (!poll_changes(camera)) {
+				// Nothing that affects the image changed: keep the previous frame on screen.
+				if (needs_present_) {
+					pipeline_->redisplay();
+					needs_present_ = false;
+				}
+				wait_for_event();
+				continue;
 			}
+			needs_present_ = false;
 
-			framebuffer_->display(&window_);
-			window_.display();
+			sf::Time delta_time = clock_.restart();
+
+			// Blocks only when frame_latency_ frames are already waiting to be presented.
+			Framebuffer& frame = pipeline_->begin_frame();
+			render_frame(camera, frame);
+			pipeline_->end_frame();
 
 			fps_ = 1.f / delta_time.asSeconds();
 
@@ -97,14 +313,133 @@ public:
 			switch (shading_mode_) {
 			case ShadingMode::FLAT: mode_str = "Flat"; break;
 			case ShadingMode::GOURAUD: mode_str = "Gouraud"; break;
-			case ShadingMode::PHONG: mode_str = "Phong"; break;
+			case ShadingMode::PHONG: mode_str = renderer_->coarse_shading() ? "Phong (coarse)" : "Phong"; break;
 			}
 
-			window_.setTitle("Pipeline - FPS: " + std::to_string(static_cast<int>(fps_)) + " | " + mode_str);
+			std::string title = "Pipeline - FPS: " + std::to_string(static_cast<int>(fps_)) + " | " + mode_str;
+			if (int pending = asset_loader_->pending(); pending > 0)
+				title += " | Loading: " + std::to_string(pending);
+			if (failed_loads_ > 0)
+				title += " | Failed to load: " + std::to_string(failed_loads_);
+			for (const auto& stream : streaming_meshes_) {
+				const auto streaming = stream->stats();
+				title += " | Chunks: " + std::to_string(streaming.resident) + "/" + std::to_string(streaming.visible) +
+					" (" + std::to_string(streaming.resident_bytes >> 20) + " MB)";
+				if (streaming.failed > 0)
+					title += ", " + std::to_string(streaming.failed) + " unreadable";
+			}
+			if (capture_)
+				title += " | REC " + std::to_string(capture_->stats().submitted);
+			if (occlusion_culler_) {
+				const auto& occlusion = occlusion_culler_->stats();
+				title += " | Occluded: " + std::to_string(occlusion.occluded) + "/" + std::to_string(occlusion.tested);
+			}
+			if (overdraw_ > 0.0f) {
+				char overdraw[64];
+				std::snprintf(overdraw, sizeof(overdraw), " | Overdraw: %.2fx %s", overdraw_,
+					renderer_->draw_order() == DrawOrder::FRONT_TO_BACK ? "sorted" : "unsorted");
+				title += overdraw;
+			}
+			if (depth_format_ != DepthFormat::FLOAT32 || depth_compression_) {
+				static const char* const kDepthFormatNames[] = { "F32", "D16", "D24" };
+				title += std::string(" | Depth: ") + kDepthFormatNames[static_cast<int>(depth_format_)];
+				if (depth_compression_) {
+					const auto tiles = renderer_->depth_buffer()->tile_stats();
+					title += " tiled (" + std::to_string(tiles.planar) + " planar, " + std::to_string(tiles.expanded) + " expanded)";
+				}
+			}
+			if (dynamic_resolution_)
+				title += " | Scale: " + std::to_string(static_cast<int>(dynamic_resolution_->scale() * 100.0f)) + "%";
+			if (frame_latency_ > 1)
+				title += " | Buffers: " + std::to_string(frame_latency_);
+			window_.setTitle(title);
 		}
+
+		pipeline_.reset();
+		window_.close();
+		return !nothing_loaded;
 	}
 
+	// Must be called from the thread running the loop; use load_mesh_async from elsewhere.
 	void add_mesh(std::unique_ptr<Mesh> mesh) {
 		meshes_.push_back(std::move(mesh));
+		scene_dirty_ = true;
+	}
+
+	// Draws a chunk file built by mesh_chunks::build, keeping at most budget_bytes of
+	// placeholders and full-detail chunks in memory. Must be called from the thread
+	// running the loop.
+	bool open_streaming_mesh(const std::string& chunk_path, size_t budget_bytes) {
+		auto stream = std::make_unique<StreamingMesh>(chunk_path, budget_bytes,
+			[this](const Mesh& mesh) { renderer_->forget_mesh(&mesh); });
+		if (!stream->is_open()) {
+			std::cerr << "Error: Cannot open chunk file: " << chunk_path << "\n";
+			return false;
+		}
+		streaming_meshes_.push_back(std::move(stream));
+		scene_dirty_ = true;
+		return true;
+	}
+
+	// Writes every rendered frame to directory as an image sequence (F5 toggles).
+	void start_capture(const std::string& directory, ImageFormat format) {
+		if (pipeline_)
+			pipeline_->flush();
+		capture_ = std::make_unique<FrameCapture>(directory, format, width_, height_);
+	}
+
+	void stop_capture() {
+		if (!capture_) return;
+		if (pipeline_)
+			pipeline_->flush();
+		capture_->finish();
+		const auto stats = capture_->stats();
+		std::cout << "Captured " << stats.written << " frames to " << capture_->directory()
+			<< " (" << stats.stalls << " encoder stalls)\n";
+		capture_.reset();
+	}
+
+	// Enables dynamic resolution, trading internal resolution for frame time (F6 toggles).
+	void set_frame_time_budget(float budget_ms) {
+		if (!dynamic_resolution_)
+			dynamic_resolution_ = std::make_unique<DynamicResolution>(budget_ms);
+		else
+			dynamic_resolution_->set_budget_ms(budget_ms);
+	}
+
+	// Null while dynamic resolution is off; exposes the scale and frame-time history.
+	const DynamicResolution* dynamic_resolution() const { return dynamic_resolution_.get(); }
+
+	// Per-frame occluded-object counts; null while occlusion culling is off (F8 toggles).
+	const OcclusionCuller* occlusion_culler() const { return occlusion_culler_.get(); }
+
+	// Depth storage format (F10 cycles) and 8x8 plane tile compression (F11 toggles).
+	// FLOAT32 without compression is the exact reference; the others trade precision or
+	// per-pixel work for depth memory traffic. Leave compression off unless the scene is
+	// made of triangles much larger than a tile; on dense meshes it is slower.
+	void set_depth_format(DepthFormat format, bool compression = false) {
+		depth_format_ = format;
+		depth_compression_ = compression;
+		scene_dirty_ = true;
+	}
+
+	// Frames that may be rendered or waiting to be presented at once (F12 cycles): 1 is
+	// the serial loop, 2 double and 3 triple buffering. Each step beyond 1 lets rendering
+	// run ahead of presentation by one more frame.
+	void set_frame_latency(int frames) {
+		frame_latency_ = std::clamp(frames, 1, 3);
+	}
+
+	// Front-to-back submission of meshes and triangles (F9 toggles).
+	void set_draw_order(DrawOrder order) { renderer_->set_draw_order(order); }
+
+	// Overdraw of the most recent frame, drawn with the current order; 0 if none yet.
+	float overdraw_ratio() const { return overdraw_; }
+
+	FrameArena::Stats frame_memory_stats() const { return frame_arena_.stats(); }
+
+	// Parses on a worker thread; the mesh appears in the scene once it is ready.
+	void load_mesh_async(const std::string& filename, AssetLoader::MeshPass pass = {}) {
+		asset_loader_->load(filename, std::move(pass));
 	}
 };
@@ -1,24 +1,39 @@
 #include <SFML/Graphics.hpp>
+#include <cstdlib>
+#include <string>
 
 #include "Mesh.h"
+#include "StreamingMesh.h"
 #include "Window.h"
 
-int main()
+// Usage: PC5 [model.obj]
+//        PC5 --stream model.obj [budget_mb]   (builds model.obj.chunks when missing or stale;
+//                                              the budget covers placeholders and detail)
+int main(int argc, char** argv)
 {
 	constexpr unsigned int width = 1000;
 	constexpr unsigned int height = 1000;
 
 	const auto window = std::make_unique<Window>(width, height, "Pipeline");
 
-	auto mesh = std::make_unique<Mesh>();
-
-	if (!mesh->load_from_obj("cow.obj")) {
-		std::cerr << "Failed to load teapot.obj" << "\n";
-		return -1;
+	if (argc >= 3 && std::string(argv[1]) == "--stream") {
+		const std::string obj_path = argv[2];
+		const std::string chunk_path = obj_path + ".chunks";
+		const size_t budget_mb = argc >= 4 ? std::strtoul(argv[3], nullptr, 10) : 512;
+		if (!mesh_chunks::is_up_to_date(chunk_path, obj_path)) {
+			mesh_chunks::BuildStats stats;
+			if (!mesh_chunks::build(obj_path, chunk_path, {}, &stats))
+				return 1;
+			std::cout << "Built " << stats.chunks << " chunks from " << stats.faces << " triangles\n";
+		}
+		if (!window->open_streaming_mesh(chunk_path, budget_mb << 20))
+			return 1;
 	}
-
-	window->add_mesh(std::move(mesh));
-	window->run();
+	else {
+		window->load_mesh_async(argc >= 2 ? argv[1] : "cow.obj");
+	}
+	if (!window->run())
+		return -1;
 	
 	return 0;
 }
@@ -0,0 +1,11 @@
+#pragma once
+#include <iostream>
+
+// Shared by the unit tests: every check prints one ok/FAIL line, and main() returns
+// non-zero if any of them failed.
+inline int failures = 0;
+
+inline void expect(bool condition, const char* what) {
+	std::cout << (condition ? "ok   " : "FAIL ") << what << "\n";
+	if (!condition) ++failures;
+}
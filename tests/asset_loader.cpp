@@ -0,0 +1,162 @@
+// Exercises the MPMC ring and AssetLoader: FIFO handoff, every item delivered exactly
+// once with several producers and consumers, failed loads counted without killing a
+// worker, workers parking on a full result queue, and shutdown while they are parked.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AssetLoader.h"
+#include "TestSupport.h"
+
+namespace {
+
+// A fan of n triangles, so each file is recognisable by its vertex count.
+void write_fan(const std::string& path, int n) {
+	std::ofstream out(path);
+	out << "v 0 0 0\n";
+	for (int i = 0; i <= n; ++i)
+		out << "v " << i << " 1 0\n";
+	for (int i = 0; i < n; ++i)
+		out << "f 1 " << i + 2 << " " << i + 3 << "\n";
+}
+
+// Polls until condition holds or a generous timeout passes.
+template<typename F>
+bool wait_until(F&& condition) {
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (!condition()) {
+		if (std::chrono::steady_clock::now() > deadline) return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+void check_queue() {
+	LockFreeQueue<int> queue(8);
+	bool fifo = true;
+	for (int i = 0; i < 8; ++i) {
+		int value = i;
+		fifo &= queue.try_push(value);
+	}
+	int extra = 8;
+	expect(fifo && !queue.try_push(extra), "ring holds exactly its capacity");
+	for (int i = 0; i < 8; ++i) {
+		int value = -1;
+		fifo &= queue.try_pop(value) && value == i;
+	}
+	int value = -1;
+	expect(fifo && !queue.try_pop(value), "ring hands values out in the order they went in");
+
+	// Several producers and consumers through a small ring: nothing lost or duplicated,
+	// and each producer's values arrive in the order it pushed them.
+	constexpr int kProducers = 4;
+	constexpr int kConsumers = 3;
+	constexpr int kPerProducer = 20000;
+	LockFreeQueue<int> shared(16);
+	std::vector<std::atomic<int>> seen(kProducers * kPerProducer);
+	std::atomic<int> consumed{ 0 };
+	std::atomic<bool> ordered{ true };
+	std::vector<std::thread> threads;
+	for (int p = 0; p < kProducers; ++p) {
+		threads.emplace_back([&, p] {
+			for (int i = 0; i < kPerProducer; ++i) {
+				int item = p * kPerProducer + i;
+				while (!shared.try_push(item)) std::this_thread::yield();
+			}
+		});
+	}
+	for (int c = 0; c < kConsumers; ++c) {
+		threads.emplace_back([&] {
+			std::vector<int> last(kProducers, -1);
+			while (consumed.load() < kProducers * kPerProducer) {
+				int item = 0;
+				if (!shared.try_pop(item)) {
+					std::this_thread::yield();
+					continue;
+				}
+				const int producer = item / kPerProducer;
+				if (item % kPerProducer <= last[producer]) ordered = false;
+				last[producer] = item % kPerProducer;
+				seen[item].fetch_add(1);
+				consumed.fetch_add(1);
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+	expect(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int>& count) { return count.load() == 1; }),
+		"every value crosses the ring exactly once");
+	expect(ordered, "each producer's values arrive in order");
+}
+
+}
+
+int main() {
+	namespace fs = std::filesystem;
+	const fs::path directory = fs::temp_directory_path() / "pc5_asset_loader_test";
+	fs::create_directories(directory);
+
+	check_queue();
+
+	std::vector<std::string> files;
+	for (int i = 0; i < 12; ++i) {
+		files.push_back((directory / ("fan" + std::to_string(i) + ".obj")).string());
+		write_fan(files.back(), i + 1);
+	}
+	const std::string malformed = (directory / "malformed.obj").string();
+	std::ofstream(malformed) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf one two three\n";
+
+	{
+		// One worker completes jobs in the order they were queued; failures do not stop it.
+		AssetLoader loader(1);
+		loader.load(files[0]);
+		loader.load((directory / "missing.obj").string());
+		loader.load(malformed);
+		loader.load(files[1]);
+		loader.load(files[2]);
+		std::vector<size_t> faces;
+		expect(wait_until([&] {
+			while (auto mesh = loader.try_take())
+				faces.push_back(mesh->face_count());
+			return loader.pending() == 0;
+		}), "pending drops to zero once every load finished or failed");
+		expect(faces == std::vector<size_t>{ 1, 2, 3 }, "meshes arrive in the order they were requested");
+		expect(loader.failed() == 2, "a missing file and a parse error each count as one failure");
+	}
+
+	{
+		// Four workers and room for two results: once every file is parsed, two wait in
+		// the queue and four workers park holding the rest.
+		std::atomic<int> passes{ 0 };
+		AssetLoader loader(4, 2);
+		for (const auto& file : files)
+			loader.load(file, [&](Mesh&) { ++passes; });
+		expect(wait_until([&] { return loader.parked() == 4; }), "workers park while the result queue is full");
+		expect(loader.pending() == 12 && passes == 6, "parked workers start no further loads");
+
+		std::vector<bool> arrived(files.size() + 1, false);
+		expect(wait_until([&] {
+			while (auto mesh = loader.try_take())
+				arrived[mesh->face_count()] = true;
+			return loader.pending() == 0;
+		}), "taking results wakes the parked workers");
+		expect(std::count(arrived.begin(), arrived.end(), true) == 12 && passes == 12, "every mesh is delivered once the queue drains");
+
+		for (const auto& file : files)
+			loader.load(file);
+		expect(wait_until([&] { return loader.parked() == 4; }), "workers park again on a full queue");
+		// The loader is destroyed here with every worker parked; the test would hang if
+		// shutdown did not wake them.
+	}
+	expect(true, "shutdown releases parked workers");
+
+	fs::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+// Drives DepthBuffer directly with large triangles and checks that every format orders
+// depths the same way, that compressed tiles hold one or two planes without per-pixel
+// storage, and that they read back exactly what the uncompressed buffer holds.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "DepthBuffer.h"
+#include "TestSupport.h"
+
+namespace {
+
+constexpr int kWidth = 61;
+constexpr int kHeight = 45;
+
+// Rasterizes the triangle the way Renderer does: pixel centres on integer coordinates,
+// counter-clockwise coverage, depth through the plane.
+void draw(DepthBuffer& depth, const DepthPlane& plane) {
+	depth.begin_triangle(plane);
+	for (int y = 0; y < kHeight; ++y) {
+		for (int x = 0; x < kWidth; ++x) {
+			const Vector2<float> p(static_cast<float>(x), static_cast<float>(y));
+			if (DepthPlane::edge(plane.b, plane.c, p) >= 0 && DepthPlane::edge(plane.c, plane.a, p) >= 0 &&
+				DepthPlane::edge(plane.a, plane.b, p) >= 0)
+				depth.test_and_set(x, y, plane.at(x, y));
+		}
+	}
+}
+
+// Orders the corners so the triangle faces the camera.
+DepthPlane make_plane(Vector2<float> a, Vector2<float> b, Vector2<float> c, float za, float zb, float zc) {
+	if (DepthPlane::edge(a, b, c) < 0.0f) {
+		std::swap(b, c);
+		std::swap(zb, zc);
+	}
+	return { a, b, c, DepthPlane::edge(a, b, c), za, zb, zc };
+}
+
+// Two halves of a screen-filling quad, a tilted plane through them and a small
+// triangle in front that only touches a few tiles.
+const DepthPlane kScene[] = {
+	make_plane({ 0, 0 }, { 0, 60 }, { 80, 0 }, 0.6f, 0.6f, 0.6f),
+	make_plane({ 80, 0 }, { 0, 60 }, { 80, 60 }, 0.6f, 0.6f, 0.6f),
+	make_plane({ 0, 0 }, { 0, 60 }, { 80, 30 }, 0.3f, 0.9f, 0.55f),
+	make_plane({ 20, 10 }, { 24, 30 }, { 40, 12 }, 0.1f, 0.1f, 0.1f),
+};
+
+std::vector<float> render(DepthFormat format, bool compression, DepthBuffer::TileStats* stats = nullptr, size_t* covered = nullptr) {
+	DepthBuffer depth(kWidth, kHeight, format, compression);
+	for (const auto& plane : kScene)
+		draw(depth, plane);
+	if (stats) *stats = depth.tile_stats();
+	if (covered) *covered = depth.covered_pixels();
+	std::vector<float> values;
+	for (int y = 0; y < kHeight; ++y)
+		for (int x = 0; x < kWidth; ++x)
+			values.push_back(depth.depth_at(x, y));
+	return values;
+}
+
+}
+
+int main() {
+	const std::vector<float> reference = render(DepthFormat::FLOAT32, false);
+	const size_t reference_covered = static_cast<size_t>(std::count_if(reference.begin(), reference.end(),
+		[](float z) { return z != std::numeric_limits<float>::max(); }));
+	for (DepthFormat format : { DepthFormat::FLOAT32, DepthFormat::UNORM16, DepthFormat::UNORM24 }) {
+		size_t plain_covered = 0, tiled_covered = 0;
+		const std::vector<float> plain = render(format, false, nullptr, &plain_covered);
+		const std::vector<float> tiled = render(format, true, nullptr, &tiled_covered);
+		const float tolerance = format == DepthFormat::UNORM16 ? 1.0f / 65535.0f : format == DepthFormat::UNORM24 ? 1.0f / 16777215.0f : 1e-6f;
+		bool close = true;
+		for (size_t i = 0; i < reference.size(); ++i)
+			close &= std::abs(plain[i] - reference[i]) <= tolerance;
+		expect(close, "format stores the reference depths at its precision");
+		expect(plain == tiled, "tiled buffer reads back the same depths");
+		expect(plain_covered == reference_covered && tiled_covered == reference_covered, "covered pixels are counted once each");
+	}
+
+	DepthBuffer::TileStats stats;
+	render(DepthFormat::FLOAT32, true, &stats);
+	expect(stats.cleared == 0, "every tile is covered");
+	expect(stats.planar > stats.expanded, "most tiles stay described by planes");
+	expect(stats.expanded > 0, "tiles touched by a third plane expand");
+
+	DepthBuffer depth(kWidth, kHeight, DepthFormat::UNORM16, true);
+	draw(depth, kScene[0]);
+	expect(depth.covered_pixels() > 0 && depth.tile_stats().expanded == 0, "one triangle leaves tiles planar");
+	depth.clear();
+	expect(depth.covered_pixels() == 0 && depth.depth_at(3, 3) == depth.clear_value(), "clear resets the tiles");
+	expect(depth.bytes_per_pixel() == 2, "16-bit format stores two bytes per pixel");
+	depth.set_format(DepthFormat::UNORM24);
+	expect(depth.bytes_per_pixel() == 3, "24-bit format stores three bytes per pixel");
+
+	return failures == 0 ? 0 : 1;
+}
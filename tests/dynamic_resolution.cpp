@@ -0,0 +1,60 @@
+// Drives DynamicResolution with a synthetic cost model (frame time proportional to
+// pixel count) and checks it settles under budget, recovers when load drops, and that
+// the bilinear upscale preserves flat colors and same-size images.
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "DynamicResolution.h"
+#include "FrameArena.h"
+#include "Framebuffer.h"
+#include "TestSupport.h"
+
+namespace {
+
+float simulate(DynamicResolution& controller, float full_resolution_ms, int frames) {
+	for (int i = 0; i < frames; ++i)
+		controller.record_frame(full_resolution_ms * controller.scale() * controller.scale());
+	return full_resolution_ms * controller.scale() * controller.scale();
+}
+
+}
+
+int main() {
+	DynamicResolution controller(16.0f, 0.25f, 1.0f);
+	const float heavy = simulate(controller, 40.0f, 200);
+	expect(heavy <= 16.0f, "heavy load settles under budget");
+	expect(controller.scale() < 1.0f && controller.scale() >= 0.25f, "heavy load lowers scale within limits");
+	expect(heavy >= 16.0f * 0.5f, "heavy load does not overshoot far below budget");
+
+	simulate(controller, 8.0f, 400);
+	expect(controller.scale() == 1.0f, "light load returns to full resolution");
+	expect(controller.history().size() == DynamicResolution::kHistorySize, "history keeps the most recent frames");
+
+	const float stable_scale = [&] { simulate(controller, 40.0f, 200); return controller.scale(); }();
+	simulate(controller, 40.0f, 100);
+	expect(controller.scale() == stable_scale, "steady load keeps a steady scale");
+
+	RenderTarget& target = controller.target(1000, 600);
+	expect(target.framebuffer->get_width() == static_cast<unsigned int>(std::lround(1000 * controller.scale())),
+		"target width follows scale");
+	expect(&controller.target(1000, 600) == &target, "targets are reused per size");
+
+	LinearArena scratch;
+	Framebuffer small(37, 23), large(100, 61);
+	small.clear(Color(200, 30, 90));
+	upscale_bilinear(small, large, scratch);
+	bool flat = true;
+	for (size_t i = 0; i < large.size_bytes(); i += 4)
+		flat &= large.data()[i] == 200 && large.data()[i + 1] == 30 && large.data()[i + 2] == 90;
+	expect(flat, "upscale keeps flat color");
+
+	Framebuffer same(37, 23);
+	for (unsigned int y = 0; y < 23; ++y)
+		for (unsigned int x = 0; x < 37; ++x)
+			small.set_pixel(x, y, Color(static_cast<uint8_t>(x * 7), static_cast<uint8_t>(y * 11), 5));
+	upscale_bilinear(small, same, scratch);
+	expect(std::memcmp(small.data(), same.data(), small.size_bytes()) == 0, "same-size upscale is a copy");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+// Renders the same frame repeatedly through Renderer with a deliberately small FrameArena
+// and checks that, once the first frames have grown it, the arena serves every later frame
+// from its existing block: capacity and the overflow count stop changing.
+#include <cstdint>
+#include <iostream>
+
+#include "CameraController.h"
+#include "DepthBuffer.h"
+#include "FrameArena.h"
+#include "Framebuffer.h"
+#include "Lighting.h"
+#include "Mesh.h"
+#include "RadixSort.h"
+#include "Renderer.h"
+#include "TestSupport.h"
+
+namespace {
+
+constexpr int kSize = 96;
+constexpr int kWarmUpFrames = 3;
+constexpr int kFrames = 20;
+
+// A grid of quads facing the camera, offset so several grids overlap in depth.
+Mesh make_grid(int cells, float z) {
+	Mesh mesh;
+	for (int y = 0; y <= cells; ++y)
+		for (int x = 0; x <= cells; ++x)
+			mesh.vertices.push_back(Vector3<float>(-1.0f + 2.0f * x / cells, -1.0f + 2.0f * y / cells, z));
+	for (int y = 0; y < cells; ++y) {
+		for (int x = 0; x < cells; ++x) {
+			const int a = y * (cells + 1) + x;
+			mesh.faces.push_back(Vector3<int>(a, a + 1, a + cells + 2));
+			mesh.faces.push_back(Vector3<int>(a, a + cells + 2, a + cells + 1));
+		}
+	}
+	mesh.calculate_normals();
+	mesh.compute_bounds();
+	return mesh;
+}
+
+}
+
+int main() {
+	Framebuffer framebuffer(kSize, kSize);
+	DepthBuffer depth(kSize, kSize);
+	Lighting lighting;
+	FrameArena arena(4 * 1024);
+	Renderer renderer(kSize, kSize, &framebuffer, &depth, &lighting, ShadingMode::PHONG);
+	renderer.set_frame_arena(&arena);
+	renderer.set_draw_order(DrawOrder::FRONT_TO_BACK);
+	RadixSorter object_sorter;
+
+	// Quantized meshes project through the arena every frame; the float mesh goes through
+	// the transform cache, and all of them are depth sorted with arena scratch.
+	Mesh meshes[3] = { make_grid(48, 0.0f), make_grid(32, -0.5f), make_grid(16, 0.5f) };
+	meshes[0].quantize(NormalEncoding::OCT16);
+	meshes[1].quantize(NormalEncoding::OCT8);
+
+	CameraController camera;
+	camera.position = Vector3<float>(0.0f, 0.0f, 3.0f);
+	const Matrix4 view = camera.getViewMatrix();
+	const Matrix4 view_proj = camera.getProjectionMatrix(ProjectionMode::PERSPECTIVE, 1.0f) * view;
+
+	FrameArena::Stats warm;
+	bool steady = true;
+	bool drawn = true;
+	for (int frame = 0; frame < kFrames; ++frame) {
+		// The same per-frame allocations Window::render_frame makes around the draws.
+		arena.begin_frame();
+		renderer.reset_stats();
+		renderer.clear_depth();
+		framebuffer.clear(Color::Black);
+
+		auto sequence = arena.make_vector<uint32_t>(3);
+		auto keys = arena.make_vector<uint32_t>(3);
+		for (uint32_t i = 0; i < 3; ++i) {
+			sequence.push_back(i);
+			keys.push_back(float_sort_key(camera.position.z - meshes[i].bounds_min.z));
+		}
+		object_sorter.sort(keys.data(), sequence.data(), sequence.size(), arena.main());
+		for (uint32_t index : sequence)
+			renderer.draw_mesh(meshes[index], view_proj * meshes[index].transform, view * meshes[index].transform, camera);
+		drawn &= renderer.stats().pixels_written > 0;
+
+		const FrameArena::Stats stats = arena.stats();
+		if (frame == kWarmUpFrames - 1) {
+			warm = stats;
+			std::cout << "     after warm-up: " << stats.capacity << " bytes capacity, " << stats.overflow_count
+				<< " overflows, " << stats.used << " bytes used per frame\n";
+		}
+		else if (frame >= kWarmUpFrames) {
+			steady &= stats.capacity == warm.capacity && stats.overflow_count == warm.overflow_count && stats.used == warm.used;
+		}
+	}
+
+	expect(drawn, "every frame draws the meshes");
+	expect(warm.overflow_count > 0, "the small arena grows during warm-up");
+	expect(warm.used <= warm.capacity, "one frame fits in the grown arena");
+	expect(steady, "identical frames after warm-up neither grow the arena nor overflow it");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+// Captures synthetic frames through FrameCapture in every format and decodes the files
+// back, checking pixels, timestamps, that backpressure never drops a frame and that
+// stats() can be read while another thread submits.
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameCapture.h"
+#include "Framebuffer.h"
+#include "ImageWriter.h"
+#include "TestSupport.h"
+
+namespace {
+
+constexpr unsigned int kWidth = 97;
+constexpr unsigned int kHeight = 61;
+constexpr int kFrames = 12;
+
+std::vector<uint8_t> read_file(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+uint32_t get_u32_be(const uint8_t* p) {
+	return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+// Flat runs, gentle gradients and noise so every QOI op gets exercised.
+void paint(Framebuffer& framebuffer, int frame) {
+	uint32_t seed = 12345u + static_cast<uint32_t>(frame);
+	for (unsigned int y = 0; y < kHeight; ++y) {
+		for (unsigned int x = 0; x < kWidth; ++x) {
+			Color color;
+			if (y < kHeight / 3) {
+				color = Color(40, 80, static_cast<uint8_t>(frame * 10));
+			}
+			else if (y < 2 * kHeight / 3) {
+				color = Color(static_cast<uint8_t>(x * 2 + frame), static_cast<uint8_t>(y * 3), static_cast<uint8_t>(x + y));
+			}
+			else {
+				seed = seed * 1664525u + 1013904223u;
+				color = Color(static_cast<uint8_t>(seed >> 24), static_cast<uint8_t>(seed >> 16), static_cast<uint8_t>(seed >> 8));
+			}
+			framebuffer.set_pixel(x, y, color);
+		}
+	}
+}
+
+bool decode_ppm(const std::vector<uint8_t>& bytes, std::vector<uint8_t>& rgb) {
+	const std::string header = "P6\n" + std::to_string(kWidth) + " " + std::to_string(kHeight) + "\n255\n";
+	if (bytes.size() != header.size() + kWidth * kHeight * 3) return false;
+	if (!std::equal(header.begin(), header.end(), bytes.begin())) return false;
+	rgb.assign(bytes.begin() + static_cast<std::ptrdiff_t>(header.size()), bytes.end());
+	return true;
+}
+
+bool decode_qoi(const std::vector<uint8_t>& bytes, std::vector<uint8_t>& rgb) {
+	if (bytes.size() < 22 || bytes[0] != 'q' || bytes[1] != 'o' || bytes[2] != 'i' || bytes[3] != 'f') return false;
+	if (get_u32_be(&bytes[4]) != kWidth || get_u32_be(&bytes[8]) != kHeight) return false;
+
+	uint8_t index[64][3] = {};
+	uint8_t r = 0, g = 0, b = 0;
+	size_t pos = 14;
+	rgb.clear();
+	while (rgb.size() < kWidth * kHeight * 3 && pos < bytes.size()) {
+		const uint8_t op = bytes[pos++];
+		int run = 1;
+		if (op == 0xFE) {
+			r = bytes[pos]; g = bytes[pos + 1]; b = bytes[pos + 2];
+			pos += 3;
+		}
+		else if ((op & 0xC0) == 0x00) {
+			r = index[op][0]; g = index[op][1]; b = index[op][2];
+		}
+		else if ((op & 0xC0) == 0x40) {
+			r += ((op >> 4) & 3) - 2; g += ((op >> 2) & 3) - 2; b += (op & 3) - 2;
+		}
+		else if ((op & 0xC0) == 0x80) {
+			const int dg = (op & 0x3F) - 32;
+			const uint8_t next = bytes[pos++];
+			r += dg + (next >> 4) - 8; g += dg; b += dg + (next & 0x0F) - 8;
+		}
+		else {
+			run = (op & 0x3F) + 1;
+		}
+		const int hash = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+		index[hash][0] = r; index[hash][1] = g; index[hash][2] = b;
+		for (int i = 0; i < run; ++i)
+			rgb.insert(rgb.end(), { r, g, b });
+	}
+	return rgb.size() == kWidth * kHeight * 3;
+}
+
+// Only understands the stored deflate blocks our encoder emits, and checks the CRCs.
+bool decode_png(const std::vector<uint8_t>& bytes, std::vector<uint8_t>& rgb) {
+	if (bytes.size() < 8 || bytes[0] != 0x89 || bytes[1] != 'P') return false;
+	std::vector<uint8_t> zlib;
+	size_t pos = 8;
+	while (pos + 12 <= bytes.size()) {
+		const uint32_t length = get_u32_be(&bytes[pos]);
+		const std::string type(bytes.begin() + static_cast<std::ptrdiff_t>(pos + 4), bytes.begin() + static_cast<std::ptrdiff_t>(pos + 8));
+		if (image_writer::crc32(&bytes[pos + 4], length + 4) != get_u32_be(&bytes[pos + 8 + length])) return false;
+		if (type == "IHDR" && (get_u32_be(&bytes[pos + 8]) != kWidth || get_u32_be(&bytes[pos + 12]) != kHeight)) return false;
+		if (type == "IDAT") zlib.insert(zlib.end(), bytes.begin() + static_cast<std::ptrdiff_t>(pos + 8), bytes.begin() + static_cast<std::ptrdiff_t>(pos + 8 + length));
+		pos += 12 + length;
+	}
+
+	std::vector<uint8_t> raw;
+	size_t offset = 2;
+	while (true) {
+		const bool last = zlib[offset] & 1;
+		const size_t length = zlib[offset + 1] | zlib[offset + 2] << 8;
+		raw.insert(raw.end(), zlib.begin() + static_cast<std::ptrdiff_t>(offset + 5), zlib.begin() + static_cast<std::ptrdiff_t>(offset + 5 + length));
+		offset += 5 + length;
+		if (last) break;
+	}
+
+	rgb.clear();
+	const size_t row = kWidth * 3 + 1;
+	if (raw.size() != row * kHeight) return false;
+	for (unsigned int y = 0; y < kHeight; ++y)
+		rgb.insert(rgb.end(), raw.begin() + static_cast<std::ptrdiff_t>(y * row + 1), raw.begin() + static_cast<std::ptrdiff_t>((y + 1) * row));
+	return true;
+}
+
+}
+
+int main() {
+	const std::filesystem::path root = std::filesystem::temp_directory_path() / "pc5_frame_capture_test";
+	std::filesystem::remove_all(root);
+
+	for (ImageFormat format : { ImageFormat::PPM, ImageFormat::QOI, ImageFormat::PNG }) {
+		const std::string directory = (root / std::string(image_writer::extension(format)).substr(1)).string();
+		Framebuffer framebuffer(kWidth, kHeight);
+		std::vector<std::vector<uint8_t>> expected;
+
+		// One encoder and two buffers in flight; small frames may still encode as fast as
+		// they arrive, so waiting is checked separately below.
+		FrameCapture capture(directory, format, kWidth, kHeight, 1, 2);
+		bool accepted = true;
+		for (int frame = 0; frame < kFrames; ++frame) {
+			paint(framebuffer, frame);
+			std::vector<uint8_t> rgb;
+			for (size_t i = 0; i < kWidth * kHeight; ++i)
+				rgb.insert(rgb.end(), framebuffer.data() + i * 4, framebuffer.data() + i * 4 + 3);
+			expected.push_back(std::move(rgb));
+			accepted &= capture.submit(framebuffer);
+		}
+		capture.finish();
+
+		const auto stats = capture.stats();
+		std::cout << "     " << directory << ": " << stats.written << " frames, " << stats.stalls << " stalls\n";
+		expect(accepted, "submit accepts every frame");
+		expect(stats.submitted == kFrames && stats.written == kFrames && stats.failed == 0, "every submitted frame is written");
+
+		bool round_trip = true;
+		for (int frame = 0; frame < kFrames; ++frame) {
+			char name[32];
+			std::snprintf(name, sizeof(name), "/frame_%06d", frame);
+			const auto bytes = read_file(directory + name + image_writer::extension(format));
+			std::vector<uint8_t> rgb;
+			bool decoded = false;
+			switch (format) {
+			case ImageFormat::PPM: decoded = decode_ppm(bytes, rgb); break;
+			case ImageFormat::QOI: decoded = decode_qoi(bytes, rgb); break;
+			case ImageFormat::PNG: decoded = decode_png(bytes, rgb); break;
+			}
+			round_trip &= decoded && rgb == expected[frame];
+		}
+		expect(round_trip, "every file decodes back to the submitted pixels");
+
+		std::ifstream timestamps(directory + "/timestamps.csv");
+		std::string line;
+		int lines = 0;
+		while (std::getline(timestamps, line)) ++lines;
+		expect(lines == kFrames + 1, "timestamps.csv has a header and one line per frame");
+	}
+
+	// A frame that takes milliseconds to encode and a single buffer in flight: the second
+	// back-to-back submit() finds the only buffer still with the encoder and must wait.
+	{
+		const unsigned int width = 1024, height = 1024;
+		const std::string directory = (root / "backpressure").string();
+		Framebuffer framebuffer(width, height);
+		framebuffer.clear(Color(10, 20, 30));
+		FrameCapture capture(directory, ImageFormat::PNG, width, height, 1, 1);
+		for (int frame = 0; frame < 4; ++frame)
+			capture.submit(framebuffer);
+		capture.finish();
+
+		const auto stats = capture.stats();
+		std::cout << "     " << directory << ": " << stats.written << " frames, " << stats.stalls << " stalls\n";
+		expect(stats.written == 4 && stats.stalls > 0, "a full buffer pool makes submit wait without dropping frames");
+	}
+
+	// Frames submitted from a presenter thread while this one polls stats() for a title,
+	// as Window does: the counts only move forward and end up complete.
+	{
+		const unsigned int width = 64, height = 64;
+		const std::string directory = (root / "concurrent").string();
+		FrameCapture capture(directory, ImageFormat::QOI, width, height, 2, 2);
+		std::atomic<bool> done{ false };
+		std::thread presenter([&] {
+			Framebuffer framebuffer(width, height);
+			for (int frame = 0; frame < 200; ++frame) {
+				framebuffer.clear(Color(static_cast<uint8_t>(frame), 0, 0));
+				capture.submit(framebuffer);
+			}
+			done = true;
+		});
+		uint64_t last_submitted = 0, polls = 0;
+		bool monotonic = true;
+		while (!done) {
+			const auto stats = capture.stats();
+			monotonic &= stats.submitted >= last_submitted && stats.written + stats.failed <= stats.submitted;
+			last_submitted = stats.submitted;
+			++polls;
+		}
+		presenter.join();
+		capture.finish();
+		const auto stats = capture.stats();
+		std::cout << "     " << directory << ": " << polls << " polls during " << stats.submitted << " submits\n";
+		expect(monotonic, "stats read during submits never run backwards or ahead");
+		expect(stats.submitted == 200 && stats.written == 200, "every frame from the presenter thread is written");
+	}
+
+	std::filesystem::remove_all(root);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// Runs FramePipeline with synthetic render and present stages of fixed cost and checks
+// that frames arrive in order and intact, that no more than frames_in_flight are ever
+// outstanding, and that with more than one buffer a frame is presented while the next
+// one renders. Timings are printed for reference only.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "FramePipeline.h"
+#include "TestSupport.h"
+
+namespace {
+
+constexpr int kFrames = 24;
+constexpr auto kStageTime = std::chrono::milliseconds(4);
+
+struct Run {
+	double milliseconds = 0.0;
+	bool in_order = true;
+	int max_outstanding = 0;
+	bool presenter_thread = true;
+	bool begun = false;
+	bool ended = false;
+	bool overlapped = false;	// a present callback saw the render stage in progress
+	FramePipeline::Stats stats;
+};
+
+// Frame i is painted with colour i; presenting checks it and sleeps like a vsync'd swap.
+Run run(int frames_in_flight) {
+	Run result;
+	std::atomic<int> outstanding{ 0 };
+	std::atomic<bool> rendering{ false };
+	int expected = 0;
+	const std::thread::id render_thread = std::this_thread::get_id();
+
+	FramePipeline::Callbacks callbacks;
+	callbacks.begin = [&] { result.begun = true; };
+	callbacks.end = [&] { result.ended = true; };
+	callbacks.present = [&](Framebuffer& frame) {
+		result.presenter_thread &= std::this_thread::get_id() != render_thread;
+		result.in_order &= frame.data()[0] == static_cast<uint8_t>(expected) && frame.data()[frame.size_bytes() - 4] == static_cast<uint8_t>(expected);
+		++expected;
+		result.overlapped |= rendering.load();
+		std::this_thread::sleep_for(kStageTime);
+		result.overlapped |= rendering.load();
+		--outstanding;
+	};
+
+	const auto start = std::chrono::steady_clock::now();
+	{
+		FramePipeline pipeline(32, 16, frames_in_flight, callbacks);
+		for (int i = 0; i < kFrames; ++i) {
+			Framebuffer& frame = pipeline.begin_frame();
+			result.max_outstanding = std::max(result.max_outstanding, ++outstanding);
+			rendering = true;
+			std::this_thread::sleep_for(kStageTime);
+			frame.clear(Color(static_cast<uint8_t>(i), 0, 0));
+			rendering = false;
+			pipeline.end_frame();
+		}
+		pipeline.flush();
+		result.stats = pipeline.stats();
+	}
+	result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result.in_order &= expected == kFrames;
+	return result;
+}
+
+}
+
+int main() {
+	const Run serial = run(1);
+	const Run double_buffered = run(2);
+	const Run triple_buffered = run(3);
+
+	for (const Run* r : { &serial, &double_buffered, &triple_buffered }) {
+		expect(r->in_order, "every frame is presented once, in order and intact");
+		expect(r->presenter_thread && r->begun && r->ended, "presenting runs on its own thread between begin and end");
+		expect(r->stats.rendered == kFrames && r->stats.presented == kFrames, "stats count every frame");
+	}
+	expect(serial.max_outstanding == 1, "one buffer keeps the loop serial");
+	expect(double_buffered.max_outstanding <= 2 && triple_buffered.max_outstanding <= 3, "outstanding frames never exceed the buffers");
+
+	std::cout << "     " << serial.milliseconds << " ms serial, " << double_buffered.milliseconds << " ms double, "
+		<< triple_buffered.milliseconds << " ms triple buffered\n";
+	expect(!serial.overlapped, "one buffer never presents while rendering");
+	expect(double_buffered.overlapped, "double buffering presents while the next frame renders");
+	expect(triple_buffered.overlapped, "triple buffering presents while the next frame renders");
+	expect(serial.stats.render_stalls > 0, "a full pipeline makes rendering wait");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+// Places a wall between the camera and a small box and checks that OcclusionCuller hides
+// the box only while it is really behind the wall, and never hides anything straddling
+// the camera or peeking past an edge.
+#include <iostream>
+
+#include "CameraController.h"
+#include "FrameArena.h"
+#include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "TestSupport.h"
+
+namespace {
+
+// Axis-aligned box centred on the origin, faces wound consistently.
+Mesh make_box(float hx, float hy, float hz) {
+	Mesh mesh;
+	for (int corner = 0; corner < 8; ++corner)
+		mesh.vertices.push_back(Vector3<float>((corner & 1) ? hx : -hx, (corner & 2) ? hy : -hy, (corner & 4) ? hz : -hz));
+	const int quads[6][4] = {
+		{ 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 },
+		{ 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 }
+	};
+	for (const auto& q : quads) {
+		mesh.faces.push_back(Vector3<int>(q[0], q[1], q[2]));
+		mesh.faces.push_back(Vector3<int>(q[0], q[2], q[3]));
+	}
+	mesh.compute_bounds();
+	return mesh;
+}
+
+bool visible(const CameraController& camera, Mesh& wall, Mesh& box, float box_x, float box_z) {
+	constexpr int kSize = 256;
+	static LinearArena scratch;
+	scratch.reset();
+
+	const Matrix4 view_proj = camera.getProjectionMatrix(ProjectionMode::PERSPECTIVE, 1.0f) * camera.getViewMatrix();
+	box.transform = Matrix4::translate(box_x, 0.0f, box_z);
+
+	OcclusionCuller culler;
+	culler.begin_frame(kSize, kSize);
+	culler.add_occluder(wall, view_proj * wall.transform, scratch);
+	return culler.is_visible(box, view_proj * box.transform);
+}
+
+}
+
+int main() {
+	CameraController camera;
+	camera.position = Vector3<float>(0.0f, 0.0f, 5.0f);
+
+	Mesh wall = make_box(2.0f, 2.0f, 0.05f);
+	wall.transform = Matrix4::translate(0.0f, 0.0f, 2.0f);
+	Mesh box = make_box(0.5f, 0.5f, 0.5f);
+
+	expect(!visible(camera, wall, box, 0.0f, -2.0f), "box behind the wall is occluded");
+	expect(visible(camera, wall, box, 0.0f, 3.5f), "box in front of the wall is visible");
+	expect(visible(camera, wall, box, 6.0f, -2.0f), "box beside the wall is visible");
+	expect(visible(camera, wall, box, 4.6f, -2.0f), "box peeking past the wall's edge is visible");
+	expect(visible(camera, wall, box, 0.0f, 5.0f), "box around the camera is visible");
+
+	// A proxy that is smaller than the wall still occludes what it covers, and a mesh
+	// too large to rasterize directly contributes nothing without one.
+	OcclusionCuller limited(4);
+	LinearArena scratch;
+	const Matrix4 view_proj = camera.getProjectionMatrix(ProjectionMode::PERSPECTIVE, 1.0f) * camera.getViewMatrix();
+	box.transform = Matrix4::translate(0.0f, 0.0f, -2.0f);
+	limited.begin_frame(256, 256);
+	limited.add_occluder(wall, view_proj * wall.transform, scratch);
+	expect(limited.stats().occluders == 0 && limited.is_visible(box, view_proj * box.transform),
+		"large mesh without a proxy does not occlude");
+
+	wall.occluder = std::make_unique<Mesh>(make_box(1.5f, 1.5f, 0.0f));
+	limited.begin_frame(256, 256);
+	limited.add_occluder(wall, view_proj * wall.transform, scratch);
+	expect(!limited.is_visible(box, view_proj * box.transform), "occluder proxy hides the box");
+	expect(limited.stats().occluded == 1 && limited.stats().tested == 1, "stats count the culled object");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+// Checks RadixSorter against std::stable_sort on serial and multi-threaded inputs,
+// including duplicate keys (stability), float depth keys and already-sorted input.
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "FrameArena.h"
+#include "RadixSort.h"
+#include "TestSupport.h"
+
+namespace {
+
+bool sorts_like_stable_sort(RadixSorter& sorter, std::vector<uint32_t> keys) {
+	std::vector<uint32_t> values(keys.size());
+	std::iota(values.begin(), values.end(), 0u);
+
+	std::vector<uint32_t> expected = values;
+	std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+	LinearArena scratch;
+	sorter.sort(keys.data(), values.data(), keys.size(), scratch);
+	return values == expected && std::is_sorted(keys.begin(), keys.end());
+}
+
+std::vector<uint32_t> random_keys(size_t count, uint32_t mask) {
+	std::vector<uint32_t> keys(count);
+	uint32_t seed = 2463534242u;
+	for (auto& key : keys) {
+		seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+		key = seed & mask;
+	}
+	return keys;
+}
+
+}
+
+int main() {
+	RadixSorter serial(1);
+	RadixSorter parallel(4, 1024);
+
+	expect(sorts_like_stable_sort(serial, random_keys(5000, 0xFFFFFFFFu)), "serial sort of random keys");
+	expect(sorts_like_stable_sort(serial, random_keys(5000, 0x0000000Fu)), "serial sort keeps equal keys in order");
+	expect(sorts_like_stable_sort(parallel, random_keys(100000, 0xFFFFFFFFu)), "parallel sort of random keys");
+	expect(sorts_like_stable_sort(parallel, random_keys(100000, 0x00FF00F0u)), "parallel sort keeps equal keys in order");
+
+	std::vector<uint32_t> depths;
+	for (int i = 0; i < 3000; ++i)
+		depths.push_back(float_sort_key(0.9f + static_cast<float>((i * 7919) % 3000) * 1e-5f));
+	depths.push_back(float_sort_key(-1.0f));
+	depths.push_back(float_sort_key(0.0f));
+	expect(sorts_like_stable_sort(serial, depths), "float keys sort in float order");
+	expect(float_sort_key(-2.0f) < float_sort_key(-1.0f) && float_sort_key(-1.0f) < float_sort_key(0.5f), "float_sort_key is monotonic");
+
+	std::vector<uint32_t> sorted(70000);
+	std::iota(sorted.begin(), sorted.end(), 0u);
+	expect(sorts_like_stable_sort(parallel, sorted), "already sorted input");
+	expect(sorts_like_stable_sort(parallel, { 7u }), "single element");
+
+	return failures == 0 ? 0 : 1;
+}
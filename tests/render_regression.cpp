@@ -0,0 +1,508 @@
+// Renders the bundled models across every shading/projection combination from fixed
+// cameras and checks them against stored reference images (mode "images") or against
+// recorded frame times (mode "perf"). Add --update to re-record the references.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "CameraController.h"
+#include "DepthBuffer.h"
+#include "Enums.h"
+#include "Framebuffer.h"
+#include "ImageWriter.h"
+#include "Lighting.h"
+#include "Mesh.h"
+#include "Renderer.h"
+
+namespace {
+
+const std::string kSourceDir = PC5_SOURCE_DIR;
+const std::string kGoldenDir = kSourceDir + "/tests/golden";
+const std::string kBaselineFile = kSourceDir + "/tests/perf_baseline.txt";
+
+constexpr unsigned int kImageSize = 160;
+constexpr unsigned int kPerfSize = 512;
+constexpr int kPerfFrames = 15;
+
+// A channel may differ by this much before a pixel counts as mismatched, and this
+// fraction of pixels may mismatch (rasterization edges shift with FP contraction).
+constexpr int kChannelTolerance = 2;
+constexpr double kMismatchFraction = 0.01;
+
+// CameraController's orthographic view is this many units wide.
+constexpr float kOrthoWidth = 10.0f;
+
+struct Model {
+	std::string name;
+	std::string file;
+	Vector3<float> camera_position;
+	// Units the orthographic view must span to frame the whole model.
+	float ortho_width = kOrthoWidth;
+};
+
+const std::vector<Model> kModels = {
+	{ "cow", "cow.obj", { 0.8f, -2.0f, 5.0f } },
+	{ "teapot", "teapot.obj", { 0.2f, 0.5f, 3.5f } },
+	{ "crashbandicoot", "crashbandicoot.obj", { 0.0f, 90.0f, 95.0f }, 180.0f },
+};
+
+const std::vector<std::pair<ShadingMode, const char*>> kShadingModes = {
+	{ ShadingMode::FLAT, "flat" },
+	{ ShadingMode::GOURAUD, "gouraud" },
+	{ ShadingMode::PHONG, "phong" },
+};
+
+const std::vector<std::pair<ProjectionMode, const char*>> kProjectionModes = {
+	{ ProjectionMode::PERSPECTIVE, "perspective" },
+	{ ProjectionMode::ORTHOGRAPHIC, "orthographic" },
+};
+
+// Owns everything needed to draw one mesh headless, mirroring Window::run.
+class OffscreenRenderer {
+	unsigned int width_;
+	unsigned int height_;
+	Framebuffer framebuffer_;
+	DepthBuffer depth_buffer_;
+	Lighting lighting_;
+	FrameArena frame_arena_;
+	Renderer renderer_;
+	float ortho_width_ = kOrthoWidth;
+
+public:
+	OffscreenRenderer(unsigned int width, unsigned int height)
+		: width_(width), height_(height), framebuffer_(width, height), depth_buffer_(static_cast<int>(width), static_cast<int>(height)),
+		renderer_(width, height, &framebuffer_, &depth_buffer_, &lighting_, ShadingMode::PHONG) {
+		renderer_.set_frame_arena(&frame_arena_);
+	}
+
+	Renderer& renderer() { return renderer_; }
+	DepthBuffer& depth_buffer() { return depth_buffer_; }
+
+	// Widens the orthographic view by scaling clip-space x and y; lighting is unaffected.
+	void set_ortho_width(float width) { ortho_width_ = width; }
+
+	void render(const Mesh& mesh, const CameraController& camera, ShadingMode shading, ProjectionMode projection) {
+		frame_arena_.begin_frame();
+		renderer_.set_shading_mode(shading);
+		renderer_.clear_depth();
+		framebuffer_.clear(Color::Black);
+
+		float aspect = static_cast<float>(width_) / static_cast<float>(height_);
+		Matrix4 view = camera.getViewMatrix();
+		Matrix4 mvp = camera.getProjectionMatrix(projection, aspect) * view * mesh.transform;
+		if (projection == ProjectionMode::ORTHOGRAPHIC) {
+			const float zoom = kOrthoWidth / ortho_width_;
+			mvp = Matrix4::scale(zoom, zoom, 1.0f) * mvp;
+		}
+		renderer_.draw_mesh(mesh, mvp, view * mesh.transform, camera);
+	}
+
+	const Framebuffer& framebuffer() const { return framebuffer_; }
+};
+
+bool write_ppm(const std::string& path, const Framebuffer& framebuffer) {
+	return image_writer::write_image(path, ImageFormat::PPM, framebuffer.data(), framebuffer.get_width(), framebuffer.get_height());
+}
+
+bool read_ppm(const std::string& path, unsigned int& width, unsigned int& height, std::vector<uint8_t>& rgb) {
+	std::ifstream file(path, std::ios::binary);
+	std::string magic;
+	int max_value = 0;
+	if (!(file >> magic >> width >> height >> max_value) || magic != "P6" || max_value != 255)
+		return false;
+	file.get();
+	rgb.resize(static_cast<size_t>(width) * height * 3);
+	file.read(reinterpret_cast<char*>(rgb.data()), static_cast<std::streamsize>(rgb.size()));
+	if (!file) return false;
+	// A black reference would let any render that draws nothing pass.
+	if (std::none_of(rgb.begin(), rgb.end(), [](uint8_t value) { return value != 0; })) {
+		std::cerr << "FAIL: reference " << path << " covers no pixels\n";
+		return false;
+	}
+	return true;
+}
+
+bool load_mesh(const Model& model, Mesh& mesh) {
+	if (!mesh.load_from_obj(kSourceDir + "/" + model.file)) {
+		std::cerr << "FAIL: cannot load " << model.file << "\n";
+		return false;
+	}
+	return true;
+}
+
+struct ImageDiff {
+	size_t mismatched = 0;
+	int worst = 0;
+	double fraction = 0.0;
+};
+
+ImageDiff compare(const Framebuffer& framebuffer, const std::vector<uint8_t>& reference, int tolerance) {
+	ImageDiff diff;
+	const size_t count = static_cast<size_t>(framebuffer.get_width()) * framebuffer.get_height();
+	const uint8_t* pixels = framebuffer.data();
+	for (size_t i = 0; i < count; ++i) {
+		int pixel_diff = 0;
+		for (int channel = 0; channel < 3; ++channel)
+			pixel_diff = std::max(pixel_diff, std::abs(pixels[i * 4 + channel] - reference[i * 3 + channel]));
+		diff.worst = std::max(diff.worst, pixel_diff);
+		if (pixel_diff > tolerance) ++diff.mismatched;
+	}
+	diff.fraction = static_cast<double>(diff.mismatched) / static_cast<double>(count);
+	return diff;
+}
+
+// Reference pixels of a golden image, or empty if it is missing, malformed or blank.
+std::vector<uint8_t> read_reference(const std::string& name) {
+	unsigned int width = 0, height = 0;
+	std::vector<uint8_t> rgb;
+	if (!read_ppm(kGoldenDir + "/" + name + ".ppm", width, height, rgb) || width != kImageSize || height != kImageSize) {
+		std::cerr << "FAIL: " << name << ": missing or malformed reference\n";
+		return {};
+	}
+	return rgb;
+}
+
+std::vector<uint8_t> rgb_pixels(const Framebuffer& framebuffer) {
+	std::vector<uint8_t> rgb;
+	const size_t count = static_cast<size_t>(framebuffer.get_width()) * framebuffer.get_height();
+	for (size_t i = 0; i < count; ++i)
+		rgb.insert(rgb.end(), framebuffer.data() + i * 4, framebuffer.data() + i * 4 + 3);
+	return rgb;
+}
+
+// Draws one variant of a reference render and holds it to the reference. The callback
+// renders into offscreen, returns false to fail the check on its own grounds and may
+// append details to the report line. Failing frames are written next to the binary.
+using RenderVariant = std::function<bool(OffscreenRenderer& offscreen, std::ostream& details)>;
+
+int check_variant(OffscreenRenderer& offscreen, const std::string& name, const std::string& label, const std::vector<uint8_t>& reference,
+	int tolerance, double mismatch_fraction, const RenderVariant& render) {
+	if (reference.empty()) return 1;
+	std::ostringstream details;
+	const bool passed = render(offscreen, details);
+	const ImageDiff diff = compare(offscreen.framebuffer(), reference, tolerance);
+	const bool ok = passed && diff.fraction <= mismatch_fraction;
+	std::cout << (ok ? "ok   " : "FAIL ") << name << " (" << label << "): " << diff.mismatched
+		<< " pixels over tolerance, max channel diff " << diff.worst << details.str() << "\n";
+	if (ok) return 0;
+	write_ppm(name + "_" + label + ".actual.ppm", offscreen.framebuffer());
+	return 1;
+}
+
+CameraController camera_for(const Model& model, OffscreenRenderer& offscreen) {
+	CameraController camera;
+	camera.position = model.camera_position;
+	offscreen.set_ortho_width(model.ortho_width);
+	return camera;
+}
+
+// Coarse Phong shading is an approximation, so it is held to the exact Phong references
+// with a looser tolerance, and must actually save shading work.
+int check_coarse_shading() {
+	constexpr int kCoarseTolerance = 8;
+	constexpr double kCoarseMismatchFraction = 0.01;
+	int failures = 0;
+	OffscreenRenderer offscreen(kImageSize, kImageSize);
+	offscreen.renderer().set_coarse_shading(true);
+
+	for (const auto& model : kModels) {
+		Mesh mesh;
+		if (!load_mesh(model, mesh)) return 1;
+		const CameraController camera = camera_for(model, offscreen);
+
+		for (const auto& [projection, projection_name] : kProjectionModes) {
+			const std::string name = model.name + "_phong_" + projection_name;
+			failures += check_variant(offscreen, name, "coarse", read_reference(name), kCoarseTolerance, kCoarseMismatchFraction,
+				[&, projection = projection](OffscreenRenderer& target, std::ostream& details) {
+					target.renderer().reset_stats();
+					target.render(mesh, camera, ShadingMode::PHONG, projection);
+					const auto& stats = target.renderer().stats();
+					details << ", " << stats.shading_evaluations << " shades for " << stats.pixels_written << " pixels";
+					return stats.pixels_written == 0 || stats.shading_evaluations < stats.pixels_written;
+				});
+		}
+	}
+	return failures;
+}
+
+// Front-to-back submission must reproduce the references while writing no more pixels
+// than submission order does.
+int check_draw_order() {
+	int failures = 0;
+	OffscreenRenderer offscreen(kImageSize, kImageSize);
+
+	for (const auto& model : kModels) {
+		Mesh mesh;
+		if (!load_mesh(model, mesh)) return 1;
+		const CameraController camera = camera_for(model, offscreen);
+
+		for (const auto& [projection, projection_name] : kProjectionModes) {
+			const std::string name = model.name + "_phong_" + projection_name;
+			failures += check_variant(offscreen, name, "sorted", read_reference(name), kChannelTolerance, kMismatchFraction,
+				[&, projection = projection](OffscreenRenderer& target, std::ostream& details) {
+					float overdraw[2];
+					for (DrawOrder order : { DrawOrder::SUBMISSION, DrawOrder::FRONT_TO_BACK }) {
+						target.renderer().set_draw_order(order);
+						target.renderer().reset_stats();
+						target.render(mesh, camera, ShadingMode::PHONG, projection);
+						overdraw[static_cast<int>(order)] = target.renderer().overdraw_ratio();
+					}
+					target.renderer().set_draw_order(DrawOrder::SUBMISSION);
+					details << ", overdraw " << overdraw[0] << "x unsorted, " << overdraw[1] << "x sorted";
+					return overdraw[1] <= overdraw[0];
+				});
+		}
+	}
+	return failures;
+}
+
+// The micro-triangle path only changes how coverage is found, so it must match the
+// general rasterizer bit for bit.
+int check_micro_triangles() {
+	int failures = 0;
+	OffscreenRenderer offscreen(kImageSize, kImageSize);
+
+	for (const auto& model : kModels) {
+		Mesh mesh;
+		if (!load_mesh(model, mesh)) return 1;
+		const CameraController camera = camera_for(model, offscreen);
+
+		for (const auto& [shading, shading_name] : kShadingModes) {
+			const std::string name = model.name + "_" + shading_name + "_perspective";
+			offscreen.renderer().set_micro_triangles(false);
+			offscreen.render(mesh, camera, shading, ProjectionMode::PERSPECTIVE);
+			failures += check_variant(offscreen, name, "micro", rgb_pixels(offscreen.framebuffer()), 0, 0.0,
+				[&, shading = shading](OffscreenRenderer& target, std::ostream& details) {
+					target.renderer().set_micro_triangles(true);
+					target.renderer().reset_stats();
+					target.render(mesh, camera, shading, ProjectionMode::PERSPECTIVE);
+					const auto& stats = target.renderer().stats();
+					details << ", " << stats.micro_triangles << " batched, " << stats.dropped_triangles << " dropped";
+					return true;
+				});
+		}
+	}
+	return failures;
+}
+
+// Quantized meshes move vertices by at most half a 16-bit step and bend normals by the
+// octahedral grid, so they are held to the references with the coarse tolerance. They
+// must also shrink the float footprint to about a half (OCT16) or well under (OCT8), keep
+// only the normal stream of their encoding, and be projected through frame scratch
+// without leaving vertices in the transform cache.
+int check_quantized() {
+	constexpr int kQuantizedTolerance = 8;
+	constexpr double kQuantizedMismatchFraction = 0.02;
+	int failures = 0;
+	OffscreenRenderer offscreen(kImageSize, kImageSize);
+
+	for (const auto& model : kModels) {
+		const std::string name = model.name + "_phong_perspective";
+		const std::vector<uint8_t> reference = read_reference(name);
+		const CameraController camera = camera_for(model, offscreen);
+
+		for (NormalEncoding encoding : { NormalEncoding::OCT8, NormalEncoding::OCT16 }) {
+			Mesh mesh;
+			if (!load_mesh(model, mesh)) return 1;
+			const size_t float_bytes = mesh.vertices.size() * sizeof(Vector3<float>) * 2 + mesh.faces.size() * sizeof(Vector3<int>);
+			mesh.quantize(encoding);
+			const size_t compact_bytes = mesh.quantized->size_bytes();
+
+			const bool oct8 = encoding == NormalEncoding::OCT8;
+			failures += check_variant(offscreen, name, oct8 ? "oct8" : "oct16", reference, kQuantizedTolerance, kQuantizedMismatchFraction,
+				[&](OffscreenRenderer& target, std::ostream& details) {
+					target.render(mesh, camera, ShadingMode::PHONG, ProjectionMode::PERSPECTIVE);
+					const size_t cached_bytes = target.renderer().transform_cache_bytes();
+					const QuantizedMesh& quantized = *mesh.quantized;
+					const bool one_encoding = oct8 ? quantized.fine_normals.empty() && quantized.compact_normals.size() == quantized.vertex_count()
+						: quantized.compact_normals.empty() && quantized.fine_normals.size() == quantized.vertex_count();
+					details << ", " << compact_bytes << " bytes instead of " << float_bytes << ", " << cached_bytes << " cached";
+					return compact_bytes < float_bytes * (oct8 ? 0.45 : 0.55) && cached_bytes == 0 && one_encoding;
+				});
+		}
+	}
+	return failures;
+}
+
+// Every depth format must reproduce the references; 16-bit depth resolves nearly coplanar
+// surfaces less finely, so it gets a wider mismatch allowance. Tile compression only
+// changes how depth is stored, so it must match the uncompressed format bit for bit.
+int check_depth_formats() {
+	constexpr double kUnorm16MismatchFraction = 0.02;
+	const std::pair<DepthFormat, const char*> formats[] = {
+		{ DepthFormat::FLOAT32, "float32" },
+		{ DepthFormat::UNORM16, "unorm16" },
+		{ DepthFormat::UNORM24, "unorm24" },
+	};
+	int failures = 0;
+	OffscreenRenderer offscreen(kImageSize, kImageSize);
+
+	for (const auto& model : kModels) {
+		Mesh mesh;
+		if (!load_mesh(model, mesh)) return 1;
+		const CameraController camera = camera_for(model, offscreen);
+		const std::string name = model.name + "_phong_perspective";
+		const std::vector<uint8_t> reference = read_reference(name);
+
+		for (const auto& [format, format_name] : formats) {
+			const double allowed = format == DepthFormat::UNORM16 ? kUnorm16MismatchFraction : kMismatchFraction;
+			failures += check_variant(offscreen, name, format_name, reference, kChannelTolerance, allowed,
+				[&, format = format](OffscreenRenderer& target, std::ostream& details) {
+					target.depth_buffer().set_format(format);
+					target.render(mesh, camera, ShadingMode::PHONG, ProjectionMode::PERSPECTIVE);
+					const std::vector<uint8_t> expected(target.framebuffer().data(), target.framebuffer().data() + target.framebuffer().size_bytes());
+
+					target.depth_buffer().set_format(format, true);
+					target.render(mesh, camera, ShadingMode::PHONG, ProjectionMode::PERSPECTIVE);
+					const bool identical = std::equal(expected.begin(), expected.end(), target.framebuffer().data());
+					const auto tiles = target.depth_buffer().tile_stats();
+					details << ", tiled " << (identical ? "identical" : "DIFFERS") << ", " << tiles.cleared << " cleared / "
+						<< tiles.planar << " planar / " << tiles.expanded << " expanded tiles";
+					return identical;
+				});
+		}
+		offscreen.depth_buffer().set_format(DepthFormat::FLOAT32);
+	}
+	return failures;
+}
+
+int check_images(bool update) {
+	int failures = 0;
+	OffscreenRenderer offscreen(kImageSize, kImageSize);
+
+	for (const auto& model : kModels) {
+		Mesh mesh;
+		if (!load_mesh(model, mesh)) return 1;
+		const CameraController camera = camera_for(model, offscreen);
+
+		for (const auto& [shading, shading_name] : kShadingModes) {
+			for (const auto& [projection, projection_name] : kProjectionModes) {
+				const std::string name = model.name + "_" + shading_name + "_" + projection_name;
+				if (update) {
+					const std::string path = kGoldenDir + "/" + name + ".ppm";
+					offscreen.render(mesh, camera, shading, projection);
+					if (!write_ppm(path, offscreen.framebuffer())) {
+						std::cerr << "FAIL: cannot write " << path << "\n";
+						++failures;
+					}
+					continue;
+				}
+
+				failures += check_variant(offscreen, name, "exact", read_reference(name), kChannelTolerance, kMismatchFraction,
+					[&, shading = shading, projection = projection](OffscreenRenderer& target, std::ostream&) {
+						target.render(mesh, camera, shading, projection);
+						return true;
+					});
+			}
+		}
+	}
+
+	if (!update) failures += check_coarse_shading() + check_draw_order() + check_micro_triangles() + check_quantized() + check_depth_formats();
+	return failures == 0 ? 0 : 1;
+}
+
+std::map<std::string, double> read_baseline() {
+	std::map<std::string, double> baseline;
+	std::ifstream file(kBaselineFile);
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		std::istringstream iss(line);
+		std::string name;
+		double ms = 0.0;
+		if (iss >> name >> ms) baseline[name] = ms;
+	}
+	return baseline;
+}
+
+int check_perf(bool update) {
+#ifndef NDEBUG
+	if (!update) {
+		std::cout << "skipped: frame times are only meaningful in optimized builds\n";
+		return 0;
+	}
+#endif
+	// A frame may take this many times its baseline (plus a small absolute slack for
+	// timer noise on tiny frames) before it counts as a regression.
+	double tolerance = 1.5;
+	if (const char* env = std::getenv("PC5_PERF_TOLERANCE")) tolerance = std::atof(env);
+	constexpr double slack_ms = 0.5;
+
+	const auto baseline = read_baseline();
+	std::ostringstream recorded;
+	recorded << "# median frame time in ms at " << kPerfSize << "x" << kPerfSize
+		<< "; regenerate with: render_regression perf --update\n";
+	int failures = 0;
+	OffscreenRenderer offscreen(kPerfSize, kPerfSize);
+
+	for (const auto& model : kModels) {
+		Mesh mesh;
+		if (!load_mesh(model, mesh)) return 1;
+		offscreen.set_ortho_width(model.ortho_width);
+
+		for (const auto& [shading, shading_name] : kShadingModes) {
+			for (const auto& [projection, projection_name] : kProjectionModes) {
+				const std::string name = model.name + "_" + shading_name + "_" + projection_name;
+				std::vector<double> times;
+				for (int frame = 0; frame < kPerfFrames; ++frame) {
+					// Nudge the camera so each frame runs the full vertex stage instead of
+					// hitting the renderer's transform cache.
+					CameraController camera;
+					camera.position = model.camera_position;
+					camera.position.x += (frame % 2) * 1e-4f;
+
+					auto start = std::chrono::steady_clock::now();
+					offscreen.render(mesh, camera, shading, projection);
+					auto end = std::chrono::steady_clock::now();
+					times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+				}
+				std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+				const double median = times[times.size() / 2];
+				recorded << name << " " << median << "\n";
+
+				if (update) continue;
+				auto it = baseline.find(name);
+				if (it == baseline.end()) {
+					std::cout << "new  " << name << ": " << median << " ms (no baseline)\n";
+					continue;
+				}
+				const bool ok = median <= it->second * tolerance + slack_ms;
+				std::cout << (ok ? "ok   " : "FAIL ") << name << ": " << median
+					<< " ms (baseline " << it->second << " ms)\n";
+				if (!ok) ++failures;
+			}
+		}
+	}
+
+	if (update) {
+		std::ofstream file(kBaselineFile);
+		file << recorded.str();
+		std::cout << recorded.str();
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "usage: render_regression images|perf [--update]\n";
+		return 2;
+	}
+	const std::string mode = argv[1];
+	const bool update = argc > 2 && std::string(argv[2]) == "--update";
+
+	if (mode == "images") return check_images(update);
+	if (mode == "perf") return check_perf(update);
+	std::cerr << "unknown mode: " << mode << "\n";
+	return 2;
+}
@@ -0,0 +1,195 @@
+// Splits a generated terrain into a chunk file and streams it through StreamingMesh with a
+// budget that holds only part of it, checking that no triangle is lost, the budget holds
+// while the camera moves, that what the camera sees ends up at full detail, and that
+// chunks whose detail cannot be read fall back to their placeholders for good.
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CameraController.h"
+#include "DepthBuffer.h"
+#include "FrameArena.h"
+#include "Framebuffer.h"
+#include "Lighting.h"
+#include "MappedFile.h"
+#include "Renderer.h"
+#include "StreamingMesh.h"
+#include "TestSupport.h"
+
+namespace {
+
+constexpr int kGrid = 96;
+constexpr float kExtent = 20.0f;
+
+// Height field of quads over [-kExtent, kExtent]^2; every other row uses "v/vt/vn"
+// references and negative indices so both parser paths are covered.
+void write_terrain(const std::string& path) {
+	std::ofstream out(path);
+	out << "# terrain\n";
+	for (int z = 0; z <= kGrid; ++z) {
+		for (int x = 0; x <= kGrid; ++x) {
+			const float px = -kExtent + 2.0f * kExtent * x / kGrid;
+			const float pz = -kExtent + 2.0f * kExtent * z / kGrid;
+			out << "v " << px << " " << 0.5f * std::sin(px * 0.7f) * std::cos(pz * 0.5f) << " " << pz << "\n";
+		}
+	}
+	const int vertices = (kGrid + 1) * (kGrid + 1);
+	for (int z = 0; z < kGrid; ++z) {
+		for (int x = 0; x < kGrid; ++x) {
+			const int a = z * (kGrid + 1) + x + 1;
+			const int b = a + 1, c = a + kGrid + 2, d = a + kGrid + 1;
+			if (z % 2 == 0)
+				out << "f " << a << " " << d << " " << c << " " << b << "\n";
+			else
+				out << "f " << a - vertices - 1 << "/1/1 " << d - vertices - 1 << "/1/1 " << c - vertices - 1 << "/1/1 " << b - vertices - 1 << "/1/1\n";
+		}
+	}
+}
+
+Matrix4 view_proj_at(float x, float z) {
+	CameraController camera;
+	camera.position = Vector3<float>(x, 1.0f, z);
+	return camera.getProjectionMatrix(ProjectionMode::PERSPECTIVE, 1.0f) * camera.getViewMatrix();
+}
+
+// Updates until every requested load has landed, like the window does between frames.
+StreamingMesh::Stats settle(StreamingMesh& stream, float x, float z) {
+	const Matrix4 view_proj = view_proj_at(x, z);
+	const Vector3<float> eye(x, 1.0f, z);
+	for (int i = 0; i < 5000; ++i) {
+		stream.update(view_proj, eye);
+		if (!stream.busy()) break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	stream.update(view_proj, eye);
+	return stream.stats();
+}
+
+}
+
+int main() {
+	namespace fs = std::filesystem;
+	const fs::path directory = fs::temp_directory_path() / "pc5_streaming_test";
+	fs::create_directories(directory);
+	const std::string obj_path = (directory / "terrain.obj").string();
+	const std::string chunk_path = (directory / "terrain.chunks").string();
+	write_terrain(obj_path);
+
+	mesh_chunks::BuildOptions options;
+	options.target_chunk_faces = 500;
+	options.coarse_grid = 4;
+	mesh_chunks::BuildStats build_stats;
+	expect(mesh_chunks::build(obj_path, chunk_path, options, &build_stats), "chunk file builds");
+	expect(build_stats.faces == 2u * kGrid * kGrid, "quads are split into two triangles each");
+	expect(build_stats.chunks > 8, "terrain is split into several chunks");
+	expect(!fs::exists(chunk_path + ".tmp") && mesh_chunks::is_up_to_date(chunk_path, obj_path), "build leaves only a current chunk file");
+	fs::last_write_time(obj_path, fs::last_write_time(chunk_path) + std::chrono::seconds(1));
+	expect(!mesh_chunks::is_up_to_date(chunk_path, obj_path), "an OBJ newer than its chunks asks for a rebuild");
+	fs::last_write_time(obj_path, fs::last_write_time(chunk_path) - std::chrono::seconds(1));
+	{
+		const std::string bad_path = (directory / "bad.chunks").string();
+		std::ofstream(bad_path, std::ios::binary) << "not a chunk file, just some bytes long enough for a header";
+		expect(!mesh_chunks::is_up_to_date(bad_path, obj_path), "a file with a foreign header asks for a rebuild");
+	}
+
+	uint64_t fine_triangles = 0, coarse_triangles = 0, fine_bytes = 0, coarse_bytes = 0;
+	size_t largest_chunk = 0;
+	{
+		MappedFile file(chunk_path);
+		mesh_chunks::FileHeader header;
+		std::memcpy(&header, file.data(), sizeof(header));
+		for (uint32_t i = 0; i < header.chunk_count; ++i) {
+			mesh_chunks::ChunkRecord record;
+			std::memcpy(&record, file.data() + sizeof(header) + i * sizeof(record), sizeof(record));
+			fine_triangles += record.fine_triangles;
+			coarse_triangles += record.coarse_triangles;
+			fine_bytes += record.fine_size;
+			coarse_bytes += record.coarse_size;
+			largest_chunk = std::max<size_t>(largest_chunk, record.fine_triangles);
+		}
+	}
+	expect(fine_triangles == build_stats.faces, "chunks hold every triangle exactly once");
+	expect(largest_chunk <= 2 * options.target_chunk_faces, "no chunk exceeds twice the target size");
+	expect(coarse_triangles * 4 < fine_triangles, "placeholders are much coarser than the chunks");
+
+	// Room for the placeholders and about a fifth of the terrain: one view fits, two do not.
+	const size_t budget = static_cast<size_t>(coarse_bytes + fine_bytes / 5);
+	size_t evicted = 0;
+	{
+		StreamingMesh stream(chunk_path, budget, [&](const Mesh&) { ++evicted; });
+		expect(stream.is_open(), "chunk file opens");
+		const auto opened = stream.stats();
+		expect(opened.resident == 0 && opened.resident_bytes > 0 && opened.resident_bytes < budget, "placeholders count against the budget");
+
+		auto left = settle(stream, -15.0f, -8.0f);
+		expect(left.visible > 0 && left.detailed == left.visible, "visible chunks reach full detail");
+		expect(left.visible < left.chunks, "chunks outside the view are culled");
+		expect(left.resident_bytes <= budget, "resident chunks fit the budget");
+
+		auto right = settle(stream, 15.0f, -8.0f);
+		expect(right.visible > 0 && right.detailed == right.visible, "chunks at the new position reach full detail");
+		expect(right.resident_bytes <= budget, "budget holds after moving");
+
+		auto back = settle(stream, -15.0f, -8.0f);
+		expect(back.detailed == back.visible && back.resident_bytes <= budget, "returning reloads what was evicted");
+		expect(evicted > 0 && back.evictions == evicted, "moving the camera evicts chunks through the callback");
+
+		size_t drawn = 0;
+		stream.for_each_drawable([&](const Mesh& mesh) { drawn += mesh.face_count(); });
+		expect(drawn > 0, "drawables are produced for the visible chunks");
+
+		// Drawing must not add per-chunk memory outside the budget.
+		Framebuffer framebuffer(64, 64);
+		DepthBuffer depth(64, 64);
+		Lighting lighting;
+		FrameArena arena;
+		Renderer renderer(64, 64, &framebuffer, &depth, &lighting, ShadingMode::PHONG);
+		renderer.set_frame_arena(&arena);
+		CameraController camera;
+		camera.position = Vector3<float>(-15.0f, 1.0f, -8.0f);
+		const Matrix4 view = camera.getViewMatrix();
+		const Matrix4 view_proj = camera.getProjectionMatrix(ProjectionMode::PERSPECTIVE, 1.0f) * view;
+		arena.begin_frame();
+		stream.for_each_drawable([&](const Mesh& mesh) { renderer.draw_mesh(mesh, view_proj * mesh.transform, view * mesh.transform, camera); });
+		expect(renderer.stats().pixels_written > 0 && renderer.transform_cache_bytes() == 0, "drawing chunks keeps no projected vertices beyond the frame");
+	}
+
+	{
+		// Point every chunk's detail past the end of a copy of the file: the loads fail, the
+		// placeholders keep drawing, and the failed chunks are not requested again.
+		const std::string damaged_path = (directory / "damaged.chunks").string();
+		fs::copy_file(chunk_path, damaged_path, fs::copy_options::overwrite_existing);
+		{
+			std::fstream file(damaged_path, std::ios::in | std::ios::out | std::ios::binary);
+			mesh_chunks::FileHeader header;
+			file.read(reinterpret_cast<char*>(&header), sizeof(header));
+			const uint64_t past_end = fs::file_size(damaged_path);
+			for (uint32_t i = 0; i < header.chunk_count; ++i) {
+				file.seekp(static_cast<std::streamoff>(sizeof(header) + i * sizeof(mesh_chunks::ChunkRecord) + offsetof(mesh_chunks::ChunkRecord, fine_offset)));
+				file.write(reinterpret_cast<const char*>(&past_end), sizeof(past_end));
+			}
+		}
+
+		StreamingMesh stream(damaged_path, budget);
+		expect(stream.is_open(), "a file with unreadable detail still opens on its placeholders");
+		const auto damaged = settle(stream, -15.0f, -8.0f);
+		expect(!stream.busy() && damaged.failed == damaged.visible && damaged.detailed == 0, "failed loads finish and are counted");
+		const auto again = settle(stream, -15.0f, -8.0f);
+		expect(again.failed == damaged.failed && again.loading == 0, "failed chunks are not requested again");
+
+		size_t drawn = 0;
+		stream.for_each_drawable([&](const Mesh& mesh) { drawn += mesh.face_count(); });
+		expect(drawn > 0, "failed chunks keep drawing their placeholders");
+	}
+
+	fs::remove_all(directory);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Draws the same mesh repeatedly through Renderer and checks the transform cache: frames
+// that only switch shading mode reuse the projected vertices, while moving the camera or
+// the mesh, changing the light or drawing another mesh runs the vertex stage again.
+#include <cstdint>
+#include <iostream>
+
+#include "CameraController.h"
+#include "DepthBuffer.h"
+#include "FrameArena.h"
+#include "Framebuffer.h"
+#include "Lighting.h"
+#include "Mesh.h"
+#include "Renderer.h"
+#include "TestSupport.h"
+
+namespace {
+
+constexpr int kSize = 64;
+
+// A grid of quads facing the camera.
+Mesh make_grid(int cells) {
+	Mesh mesh;
+	for (int y = 0; y <= cells; ++y)
+		for (int x = 0; x <= cells; ++x)
+			mesh.vertices.push_back(Vector3<float>(-1.0f + 2.0f * x / cells, -1.0f + 2.0f * y / cells, 0.0f));
+	for (int y = 0; y < cells; ++y) {
+		for (int x = 0; x < cells; ++x) {
+			const int a = y * (cells + 1) + x;
+			mesh.faces.push_back(Vector3<int>(a, a + 1, a + cells + 2));
+			mesh.faces.push_back(Vector3<int>(a, a + cells + 2, a + cells + 1));
+		}
+	}
+	mesh.calculate_normals();
+	mesh.compute_bounds();
+	return mesh;
+}
+
+class Harness {
+	Framebuffer framebuffer_{ kSize, kSize };
+	DepthBuffer depth_{ kSize, kSize };
+	FrameArena arena_;
+
+public:
+	Lighting lighting;
+	Renderer renderer{ kSize, kSize, &framebuffer_, &depth_, &lighting, ShadingMode::PHONG };
+
+	Harness() { renderer.set_frame_arena(&arena_); }
+
+	// Draws one frame and returns how many vertices went through the vertex stage.
+	uint64_t draw(const Mesh& mesh, const CameraController& camera) {
+		arena_.begin_frame();
+		renderer.reset_stats();
+		renderer.clear_depth();
+		framebuffer_.clear(Color::Black);
+		const Matrix4 view = camera.getViewMatrix();
+		const Matrix4 mvp = camera.getProjectionMatrix(ProjectionMode::PERSPECTIVE, 1.0f) * view * mesh.transform;
+		renderer.draw_mesh(mesh, mvp, view * mesh.transform, camera);
+		return renderer.stats().vertices_transformed;
+	}
+};
+
+}
+
+int main() {
+	Harness harness;
+	Mesh mesh = make_grid(8);
+	const uint64_t vertex_count = mesh.vertices.size();
+	CameraController camera;
+	camera.position = Vector3<float>(0.0f, 0.0f, 3.0f);
+
+	expect(harness.draw(mesh, camera) == vertex_count, "the first frame transforms every vertex");
+	expect(harness.renderer.stats().pixels_written > 0, "the grid is on screen");
+	expect(harness.draw(mesh, camera) == 0, "an unchanged frame reuses the cache");
+
+	for (ShadingMode mode : { ShadingMode::FLAT, ShadingMode::GOURAUD, ShadingMode::PHONG }) {
+		harness.renderer.set_shading_mode(mode);
+		expect(harness.draw(mesh, camera) == 0, "switching shading mode reuses the cache");
+	}
+
+	camera.position.x += 0.25f;
+	expect(harness.draw(mesh, camera) == vertex_count, "moving the camera transforms again");
+	expect(harness.draw(mesh, camera) == 0, "the moved camera is cached in turn");
+
+	mesh.transform = Matrix4::translate(0.0f, 0.2f, 0.0f);
+	expect(harness.draw(mesh, camera) == vertex_count, "moving the mesh transforms again");
+
+	harness.lighting.set_light_position(Vector3<float>(1.0f, 2.0f, 3.0f));
+	expect(harness.draw(mesh, camera) == vertex_count, "changing the light transforms again");
+
+	Mesh other = make_grid(4);
+	expect(harness.draw(other, camera) == other.vertices.size(), "another mesh has its own entry");
+	expect(harness.draw(mesh, camera) == 0, "drawing another mesh leaves the first one cached");
+
+	harness.renderer.forget_mesh(&mesh);
+	expect(harness.draw(mesh, camera) == vertex_count, "a forgotten mesh is transformed again");
+
+	return failures == 0 ? 0 : 1;
+}